@@ -0,0 +1,333 @@
+#include "batch_reader.hpp"
+
+#include <algorithm>
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+static int uring_setup(unsigned entries, io_uring_params* params) {
+  return (int)syscall(__NR_io_uring_setup, entries, params);
+}
+
+static int uring_enter(int fd, unsigned to_submit, unsigned min_complete,
+                       unsigned flags) {
+  return (int)syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags,
+                      nullptr, 0);
+}
+
+static int uring_register(int fd, unsigned opcode, void* arg, unsigned count) {
+  return (int)syscall(__NR_io_uring_register, fd, opcode, arg, count);
+}
+
+BatchReader::BatchReader(unsigned entries, size_t buffer_size)
+    : m_entries(std::max(1u, entries)), m_buffer_size(buffer_size),
+      m_syscalls(0), m_ring_fd(-1), m_fixed(false), m_sq_ptr(MAP_FAILED),
+      m_sq_size(0), m_cq_ptr(MAP_FAILED), m_cq_size(0), m_sqes(nullptr),
+      m_sqes_size(0) {
+  if (!setup_uring())
+    teardown_uring();
+
+  m_buffers.resize(m_entries * m_buffer_size);
+  m_iovecs.resize(m_entries);
+  for (unsigned i = 0; i < m_entries; i++) {
+    m_iovecs[i].iov_base = m_buffers.data() + i * m_buffer_size;
+    m_iovecs[i].iov_len = m_buffer_size;
+  }
+
+  // Registered buffers spare the kernel from mapping the pages on every read,
+  // but they count against RLIMIT_MEMLOCK: plain reads are used otherwise.
+  if (uring() && m_fixed)
+    m_fixed = uring_register(m_ring_fd, IORING_REGISTER_BUFFERS,
+                             m_iovecs.data(), m_entries) == 0;
+}
+
+BatchReader::~BatchReader() { teardown_uring(); }
+
+bool BatchReader::setup_uring() {
+  io_uring_params params;
+  memset(&params, 0, sizeof(params));
+
+  m_ring_fd = uring_setup(m_entries, &params);
+  if (m_ring_fd < 0)
+    return false;
+  m_entries = std::min(m_entries, params.sq_entries);
+
+  // Needs openat and close (5.6), which also brought the probe
+  io_uring_probe* probe = (io_uring_probe*)calloc(
+      1, sizeof(io_uring_probe) + 256 * sizeof(io_uring_probe_op));
+  const bool probed =
+      uring_register(m_ring_fd, IORING_REGISTER_PROBE, probe, 256) == 0;
+  const auto supported = [probe](int op) {
+    return op <= probe->last_op &&
+           (probe->ops[op].flags & IO_URING_OP_SUPPORTED) != 0;
+  };
+  const bool usable = probed && supported(IORING_OP_OPENAT) &&
+                      supported(IORING_OP_READ) && supported(IORING_OP_CLOSE);
+  m_fixed = probed && supported(IORING_OP_READ_FIXED);
+  free(probe);
+  if (!usable)
+    return false;
+
+  m_sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+  m_cq_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+  if (params.features & IORING_FEAT_SINGLE_MMAP)
+    m_sq_size = m_cq_size = std::max(m_sq_size, m_cq_size);
+
+  m_sq_ptr = mmap(nullptr, m_sq_size, PROT_READ | PROT_WRITE,
+                  MAP_SHARED | MAP_POPULATE, m_ring_fd, IORING_OFF_SQ_RING);
+  if (m_sq_ptr == MAP_FAILED)
+    return false;
+
+  if (params.features & IORING_FEAT_SINGLE_MMAP) {
+    m_cq_ptr = m_sq_ptr;
+  } else {
+    m_cq_ptr = mmap(nullptr, m_cq_size, PROT_READ | PROT_WRITE,
+                    MAP_SHARED | MAP_POPULATE, m_ring_fd, IORING_OFF_CQ_RING);
+    if (m_cq_ptr == MAP_FAILED)
+      return false;
+  }
+
+  m_sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+  void* sqes = mmap(nullptr, m_sqes_size, PROT_READ | PROT_WRITE,
+                    MAP_SHARED | MAP_POPULATE, m_ring_fd, IORING_OFF_SQES);
+  if (sqes == MAP_FAILED)
+    return false;
+  m_sqes = (io_uring_sqe*)sqes;
+
+  char* sq = (char*)m_sq_ptr;
+  m_sq_head = (unsigned*)(sq + params.sq_off.head);
+  m_sq_tail = (unsigned*)(sq + params.sq_off.tail);
+  m_sq_mask = (unsigned*)(sq + params.sq_off.ring_mask);
+  m_sq_array = (unsigned*)(sq + params.sq_off.array);
+
+  char* cq = (char*)m_cq_ptr;
+  m_cq_head = (unsigned*)(cq + params.cq_off.head);
+  m_cq_tail = (unsigned*)(cq + params.cq_off.tail);
+  m_cq_mask = (unsigned*)(cq + params.cq_off.ring_mask);
+  m_cqes = (io_uring_cqe*)(cq + params.cq_off.cqes);
+  return true;
+}
+
+void BatchReader::teardown_uring() {
+  if (m_sqes)
+    munmap(m_sqes, m_sqes_size);
+  if (m_cq_ptr != MAP_FAILED && m_cq_ptr != m_sq_ptr)
+    munmap(m_cq_ptr, m_cq_size);
+  if (m_sq_ptr != MAP_FAILED)
+    munmap(m_sq_ptr, m_sq_size);
+  if (m_ring_fd >= 0)
+    close(m_ring_fd);
+
+  m_sqes = nullptr;
+  m_cq_ptr = m_sq_ptr = MAP_FAILED;
+  m_ring_fd = -1;
+  m_fixed = false;
+}
+
+void BatchReader::read(const std::vector<std::string>& paths,
+                       std::vector<std::string>& contents,
+                       std::vector<char>& success) {
+  m_syscalls = 0;
+  contents.resize(paths.size());
+  success.assign(paths.size(), 0);
+
+  if (!uring()) {
+    read_sync(paths, 0, contents, success);
+    return;
+  }
+
+  for (size_t first = 0; first < paths.size(); first += m_entries) {
+    if (read_batch(paths, first,
+                   std::min<size_t>(m_entries, paths.size() - first),
+                   contents, success))
+      continue;
+
+    // The ring may still hold entries of the failed batch, it is not reused
+    teardown_uring();
+    read_sync(paths, first, contents, success);
+    return;
+  }
+}
+
+void BatchReader::read_sync(const std::vector<std::string>& paths,
+                            size_t first, std::vector<std::string>& contents,
+                            std::vector<char>& success) {
+  char* buffer = m_buffers.data();
+  for (size_t i = first; i < paths.size(); i++) {
+    m_syscalls++;
+    const int fd = open(paths[i].c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+      continue;
+
+    m_syscalls += 2;
+    const ssize_t n = ::read(fd, buffer, m_buffer_size);
+    if (n < 0) {
+      close(fd);
+      continue;
+    }
+
+    contents[i].assign(buffer, n);
+    if ((size_t)n == m_buffer_size)
+      read_rest(fd, contents[i]);
+    close(fd);
+    success[i] = 1;
+  }
+}
+
+void BatchReader::read_rest(int fd, std::string& content) {
+  char* buffer = m_buffers.data();
+  for (;;) {
+    m_syscalls++;
+    const ssize_t n = ::read(fd, buffer, m_buffer_size);
+    if (n <= 0)
+      break;
+    content.append(buffer, n);
+  }
+}
+
+io_uring_sqe* BatchReader::next_sqe() {
+  const unsigned tail = *m_sq_tail;
+  const unsigned index = tail & *m_sq_mask;
+  io_uring_sqe* sqe = &m_sqes[index];
+  memset(sqe, 0, sizeof(*sqe));
+  m_sq_array[index] = index;
+  // Published to the kernel by submit_and_wait()
+  __atomic_store_n(m_sq_tail, tail + 1, __ATOMIC_RELAXED);
+  return sqe;
+}
+
+bool BatchReader::submit_and_wait(unsigned count, std::vector<int>& results,
+                                  unsigned& submitted) {
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+
+  submitted = 0;
+  unsigned completed = 0;
+  bool failed = false;
+  while (completed < count) {
+    // Once failed, only the entries the kernel already took are waited for
+    const unsigned to_submit = failed ? 0 : count - submitted;
+    const unsigned to_complete =
+        failed ? submitted - completed : count - completed;
+    if (to_complete == 0)
+      break;
+
+    m_syscalls++;
+    const int ret = uring_enter(m_ring_fd, to_submit, to_complete,
+                                IORING_ENTER_GETEVENTS);
+    const bool error =
+        ret < 0 && errno != EINTR && errno != EAGAIN && errno != EBUSY;
+    if (ret > 0)
+      submitted += ret;
+
+    unsigned head = *m_cq_head;
+    const unsigned tail = __atomic_load_n(m_cq_tail, __ATOMIC_ACQUIRE);
+    for (; head != tail; head++) {
+      const io_uring_cqe& cqe = m_cqes[head & *m_cq_mask];
+      results[cqe.user_data] = cqe.res;
+      completed++;
+    }
+    __atomic_store_n(m_cq_head, head, __ATOMIC_RELEASE);
+
+    if (error) {
+      if (failed)
+        break;
+      failed = true;
+    }
+  }
+  return !failed;
+}
+
+bool BatchReader::read_batch(const std::vector<std::string>& paths,
+                             size_t first, size_t count,
+                             std::vector<std::string>& contents,
+                             std::vector<char>& success) {
+  // Opens, reads and closes are submitted as three rounds: the reads need the
+  // descriptors returned by the opens.
+  std::vector<int> fds(count, -1);
+  for (size_t i = 0; i < count; i++) {
+    io_uring_sqe* sqe = next_sqe();
+    sqe->opcode = IORING_OP_OPENAT;
+    sqe->fd = AT_FDCWD;
+    sqe->addr = (uint64_t)(uintptr_t)paths[first + i].c_str();
+    sqe->open_flags = O_RDONLY | O_CLOEXEC;
+    sqe->user_data = i;
+  }
+  unsigned submitted;
+  bool ok = submit_and_wait(count, fds, submitted);
+
+  std::vector<int> sizes(count, -1);
+  unsigned reads = 0;
+  for (size_t i = 0; ok && i < count; i++) {
+    if (fds[i] < 0)
+      continue;
+    io_uring_sqe* sqe = next_sqe();
+    sqe->opcode = m_fixed ? IORING_OP_READ_FIXED : IORING_OP_READ;
+    sqe->fd = fds[i];
+    sqe->addr = (uint64_t)(uintptr_t)m_iovecs[i].iov_base;
+    sqe->len = m_buffer_size;
+    sqe->buf_index = i;
+    sqe->user_data = i;
+    reads++;
+  }
+  if (reads > 0)
+    ok = submit_and_wait(reads, sizes, submitted);
+
+  if (!ok) {
+    // The descriptors opened so far are ours, the reads left in flight are
+    // cancelled when the ring is torn down
+    for (size_t i = 0; i < count; i++)
+      if (fds[i] >= 0)
+        close(fds[i]);
+    return false;
+  }
+
+  std::vector<int> closes(count, 0);
+  std::vector<size_t> order;
+  for (size_t i = 0; i < count; i++) {
+    if (fds[i] < 0)
+      continue;
+    io_uring_sqe* sqe = next_sqe();
+    sqe->opcode = IORING_OP_CLOSE;
+    sqe->fd = fds[i];
+    sqe->user_data = i;
+    order.push_back(i);
+  }
+  ok = order.empty() || submit_and_wait(order.size(), closes, submitted);
+  if (!ok) {
+    // Closing again one the kernel took could close a descriptor reused by
+    // another thread, only the ones never submitted are closed here
+    for (size_t k = submitted; k < order.size(); k++)
+      close(fds[order[k]]);
+    return false;
+  }
+
+  for (size_t i = 0; i < count; i++) {
+    if (sizes[i] < 0)
+      continue;
+    contents[first + i].assign((const char*)m_iovecs[i].iov_base, sizes[i]);
+    success[first + i] = 1;
+  }
+
+  // Rare enough for a second, synchronous, pass. A procfs file is generated
+  // again on open, so the whole of it is read anew.
+  for (size_t i = 0; i < count; i++) {
+    if ((size_t)sizes[i] != m_buffer_size)
+      continue;
+
+    m_syscalls++;
+    const int fd = open(paths[first + i].c_str(), O_RDONLY | O_CLOEXEC);
+    success[first + i] = fd >= 0;
+    if (fd < 0)
+      continue;
+    contents[first + i].clear();
+    read_rest(fd, contents[first + i]);
+    m_syscalls++;
+    close(fd);
+  }
+  return true;
+}
@@ -0,0 +1,73 @@
+#ifndef __BATCH_READER_HPP__
+#define __BATCH_READER_HPP__
+
+#include <stdint.h>
+#include <string>
+#include <sys/uio.h>
+#include <vector>
+
+struct io_uring_sqe;
+struct io_uring_cqe;
+
+// Reads many small files (procfs, sysfs) in one go. When io_uring is
+// available the opens, reads and closes are submitted as batches of up to
+// `entries` files, each batch costing three io_uring_enter() calls instead
+// of three syscalls per file. Otherwise it falls back to open/read/close.
+class BatchReader {
+public:
+  BatchReader(unsigned entries = 256, size_t buffer_size = 4096);
+  ~BatchReader();
+
+  // Files filling buffer_size are read again synchronously, to their end
+  void read(const std::vector<std::string>& paths,
+            std::vector<std::string>& contents, std::vector<char>& success);
+
+  bool uring() const { return m_ring_fd >= 0; }
+  bool fixed_buffers() const { return m_fixed; }
+  // Number of syscalls issued by the last read()
+  uint64_t syscalls() const { return m_syscalls; }
+
+private:
+  bool setup_uring();
+  // Appends the rest of the file to content
+  void read_rest(int fd, std::string& content);
+  void teardown_uring();
+  void read_sync(const std::vector<std::string>& paths, size_t first,
+                 std::vector<std::string>& contents,
+                 std::vector<char>& success);
+  // False when the ring failed, the batch is then left to read_sync()
+  bool read_batch(const std::vector<std::string>& paths, size_t first,
+                  size_t count, std::vector<std::string>& contents,
+                  std::vector<char>& success);
+  io_uring_sqe* next_sqe();
+  // The entries are submitted in the order they were queued, submitted tells
+  // how many the kernel took when it fails
+  bool submit_and_wait(unsigned count, std::vector<int>& results,
+                       unsigned& submitted);
+
+  unsigned m_entries;
+  size_t m_buffer_size;
+  std::vector<char> m_buffers;
+  std::vector<struct iovec> m_iovecs;
+  uint64_t m_syscalls;
+
+  int m_ring_fd;
+  bool m_fixed;
+  void* m_sq_ptr;
+  size_t m_sq_size;
+  void* m_cq_ptr;
+  size_t m_cq_size;
+  io_uring_sqe* m_sqes;
+  size_t m_sqes_size;
+
+  unsigned* m_sq_head;
+  unsigned* m_sq_tail;
+  unsigned* m_sq_mask;
+  unsigned* m_sq_array;
+  unsigned* m_cq_head;
+  unsigned* m_cq_tail;
+  unsigned* m_cq_mask;
+  io_uring_cqe* m_cqes;
+};
+
+#endif
@@ -0,0 +1,243 @@
+#include "cgroups.hpp"
+
+#include <errno.h>
+#include <filesystem>
+#include <mntent.h>
+#include <sstream>
+#include <string.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+static const char* CGROUP_FILE_NAMES[CGROUP_FILES] = {
+    "cpu.stat", "memory.current", "memory.events", "io.stat", "pids.current",
+};
+
+const char* cgroup_file_name(cgroup_file_t file) {
+  return CGROUP_FILE_NAMES[file];
+}
+
+void parse_cgroup_file(cgroup_file_t file, const std::string& text,
+                       cgroup_stat_t& stat) {
+  std::istringstream iss(text);
+  std::string key;
+  uint64_t value;
+
+  switch (file) {
+  case CGROUP_CPU_STAT:
+    while (iss >> key >> value) {
+      if (key == "usage_usec")
+        stat.usage_usec = value;
+      else if (key == "user_usec")
+        stat.user_usec = value;
+      else if (key == "system_usec")
+        stat.system_usec = value;
+      else if (key == "nr_throttled")
+        stat.nr_throttled = value;
+      else if (key == "throttled_usec")
+        stat.throttled_usec = value;
+    }
+    break;
+
+  case CGROUP_MEMORY_CURRENT:
+    iss >> stat.memory_current;
+    break;
+
+  case CGROUP_MEMORY_EVENTS:
+    while (iss >> key >> value) {
+      if (key == "high")
+        stat.memory_high = value;
+      else if (key == "max")
+        stat.memory_max = value;
+      else if (key == "oom")
+        stat.oom = value;
+      else if (key == "oom_kill")
+        stat.oom_kill = value;
+    }
+    break;
+
+  case CGROUP_IO_STAT: {
+    // "<major>:<minor> rbytes=... wbytes=... rios=... wios=... ..." per line
+    std::string line;
+    while (std::getline(iss, line)) {
+      std::istringstream fields(line);
+      std::string field;
+      fields >> field; // device
+      while (fields >> field) {
+        const size_t equal = field.find('=');
+        if (equal == std::string::npos)
+          continue;
+        const std::string name = field.substr(0, equal);
+        const uint64_t count = strtoull(field.c_str() + equal + 1, NULL, 10);
+        if (name == "rbytes")
+          stat.rbytes += count;
+        else if (name == "wbytes")
+          stat.wbytes += count;
+        else if (name == "rios")
+          stat.rios += count;
+        else if (name == "wios")
+          stat.wios += count;
+      }
+    }
+    break;
+  }
+
+  case CGROUP_PIDS_CURRENT:
+    iss >> stat.pids_current;
+    break;
+
+  default:
+    return;
+  }
+
+  stat.present[file] = true;
+}
+
+std::string cgroup2_root() {
+  std::string root;
+
+  FILE* mounts = setmntent("/proc/self/mounts", "r");
+  if (mounts == NULL)
+    return root;
+
+  struct mntent* mount;
+  while ((mount = getmntent(mounts)) != NULL) {
+    if (strcmp(mount->mnt_type, "cgroup2") == 0) {
+      root = mount->mnt_dir;
+      break;
+    }
+  }
+
+  endmntent(mounts);
+  return root;
+}
+
+bool cgroup_path_less::operator()(const std::string& a,
+                                  const std::string& b) const {
+  const size_t n = std::min(a.size(), b.size());
+  for (size_t i = 0; i < n; i++) {
+    if (a[i] == b[i])
+      continue;
+    if (a[i] == '/')
+      return true;
+    if (b[i] == '/')
+      return false;
+    return (unsigned char)a[i] < (unsigned char)b[i];
+  }
+  return a.size() < b.size();
+}
+
+CgroupTree::CgroupTree(const std::string& root) : m_root(root) {
+  m_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  walk();
+}
+
+CgroupTree::~CgroupTree() {
+  if (m_fd >= 0)
+    close(m_fd);
+}
+
+void CgroupTree::walk() {
+  for (const auto& watch : m_watches)
+    inotify_rm_watch(m_fd, watch.first);
+  m_watches.clear();
+  m_paths.clear();
+
+  add("");
+}
+
+void CgroupTree::add(const std::string& path) {
+  const std::string absolute = path.empty() ? m_root : m_root + "/" + path;
+
+  // Watched before being listed so that no child created in between is missed
+  if (m_fd >= 0) {
+    const int wd = inotify_add_watch(m_fd, absolute.c_str(),
+                                     IN_CREATE | IN_DELETE | IN_MOVED_FROM |
+                                         IN_MOVED_TO | IN_ONLYDIR);
+    if (wd >= 0)
+      m_watches[wd] = path;
+  }
+  m_paths.insert(path);
+
+  std::error_code error;
+  for (const auto& e : std::filesystem::directory_iterator(absolute, error)) {
+    if (!e.is_directory(error))
+      continue;
+
+    const std::string name = e.path().filename().string();
+    add(path.empty() ? name : path + "/" + name);
+  }
+}
+
+static bool in_subtree(const std::string& path, const std::string& root) {
+  return path == root || path.compare(0, root.size() + 1, root + "/") == 0;
+}
+
+void CgroupTree::remove(const std::string& path) {
+  auto it = m_paths.find(path);
+  while (it != m_paths.end() && in_subtree(*it, path))
+    it = m_paths.erase(it);
+
+  // Removed directories have their watches released by the kernel, but a
+  // renamed one keeps them under its previous path
+  for (auto watch = m_watches.begin(); watch != m_watches.end();) {
+    if (in_subtree(watch->second, path)) {
+      inotify_rm_watch(m_fd, watch->first);
+      watch = m_watches.erase(watch);
+    } else {
+      watch++;
+    }
+  }
+}
+
+bool CgroupTree::update() {
+  if (m_fd < 0) {
+    const std::set<std::string, cgroup_path_less> previous = m_paths;
+    walk();
+    return previous != m_paths;
+  }
+
+  bool changed = false;
+  alignas(struct inotify_event) char buffer[4096];
+  for (;;) {
+    const ssize_t length = read(m_fd, buffer, sizeof(buffer));
+    if (length <= 0)
+      break;
+
+    for (ssize_t offset = 0; offset < length;) {
+      const struct inotify_event* event =
+          (const struct inotify_event*)(buffer + offset);
+      offset += sizeof(struct inotify_event) + event->len;
+
+      // The walk resyncs the watches, the rest of the buffer is stale
+      if (event->mask & IN_Q_OVERFLOW) {
+        walk();
+        changed = true;
+        break;
+      }
+
+      const auto watch = m_watches.find(event->wd);
+      if (watch == m_watches.end())
+        continue;
+
+      if (event->mask & IN_IGNORED) {
+        m_watches.erase(watch);
+        continue;
+      }
+
+      if (!(event->mask & IN_ISDIR) || event->len == 0)
+        continue;
+
+      const std::string& parent = watch->second;
+      const std::string path =
+          parent.empty() ? event->name : parent + "/" + event->name;
+
+      if (event->mask & (IN_CREATE | IN_MOVED_TO))
+        add(path);
+      else if (event->mask & (IN_DELETE | IN_MOVED_FROM))
+        remove(path);
+      changed = true;
+    }
+  }
+
+  return changed;
+}
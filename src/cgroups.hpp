@@ -0,0 +1,87 @@
+#ifndef __CGROUPS_HPP__
+#define __CGROUPS_HPP__
+
+#include <map>
+#include <set>
+#include <stdint.h>
+#include <string>
+
+// Files read for every cgroup, the root cgroup only has cpu.stat
+enum cgroup_file_t {
+  CGROUP_CPU_STAT,
+  CGROUP_MEMORY_CURRENT,
+  CGROUP_MEMORY_EVENTS,
+  CGROUP_IO_STAT,
+  CGROUP_PIDS_CURRENT,
+  CGROUP_FILES,
+};
+
+struct cgroup_stat_t {
+  bool present[CGROUP_FILES];
+
+  // cpu.stat, in microseconds
+  uint64_t usage_usec;
+  uint64_t user_usec;
+  uint64_t system_usec;
+  uint64_t nr_throttled;
+  uint64_t throttled_usec;
+
+  uint64_t memory_current;
+  // memory.events
+  uint64_t memory_high;
+  uint64_t memory_max;
+  uint64_t oom;
+  uint64_t oom_kill;
+
+  // io.stat, summed over the devices
+  uint64_t rbytes;
+  uint64_t wbytes;
+  uint64_t rios;
+  uint64_t wios;
+
+  uint64_t pids_current;
+};
+
+const char* cgroup_file_name(cgroup_file_t file);
+void parse_cgroup_file(cgroup_file_t file, const std::string& text,
+                       cgroup_stat_t& stat);
+
+// Mount point of the cgroup2 hierarchy, empty when there is none
+std::string cgroup2_root();
+
+// Orders the paths depth first: "a", "a/b", "a-b" rather than "a", "a-b",
+// "a/b", so a subtree is always contiguous.
+struct cgroup_path_less {
+  bool operator()(const std::string& a, const std::string& b) const;
+};
+
+// The cgroups below root, as paths relative to it ("" being the root). The
+// hierarchy is walked once, then kept up to date from the inotify events of
+// the directory creations and removals. Without inotify it is walked again
+// on every update.
+class CgroupTree {
+public:
+  CgroupTree(const std::string& root);
+  ~CgroupTree();
+
+  // Applies the pending events without blocking, true when something changed
+  bool update();
+
+  const std::string& root() const { return m_root; }
+  const std::set<std::string, cgroup_path_less>& paths() const {
+    return m_paths;
+  }
+  bool inotify() const { return m_fd >= 0; }
+
+private:
+  void walk();
+  void add(const std::string& path);
+  void remove(const std::string& path);
+
+  std::string m_root;
+  int m_fd;
+  std::map<int, std::string> m_watches;
+  std::set<std::string, cgroup_path_less> m_paths;
+};
+
+#endif
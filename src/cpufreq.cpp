@@ -0,0 +1,96 @@
+#include "cpufreq.hpp"
+
+#include <algorithm>
+#include <fcntl.h>
+#include <filesystem>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+static bool read_number(int fd, uint64_t& value) {
+  if (fd < 0)
+    return false;
+
+  char buffer[32];
+  const ssize_t n = pread(fd, buffer, sizeof(buffer) - 1, 0);
+  if (n <= 0)
+    return false;
+  buffer[n] = '\0';
+
+  char* end;
+  value = strtoull(buffer, &end, 10);
+  return end != buffer;
+}
+
+static int open_attribute(const std::string& cpu, const char* name) {
+  return open((cpu + "/" + name).c_str(), O_RDONLY | O_CLOEXEC);
+}
+
+CpuFrequencies::CpuFrequencies(const std::string& root)
+    : m_frequency(false), m_throttling(false) {
+  std::error_code ec;
+  for (const auto& entry : std::filesystem::directory_iterator(root, ec)) {
+    const std::string name = entry.path().filename().string();
+    if (name.compare(0, 3, "cpu") != 0 || name.size() == 3 ||
+        strspn(name.c_str() + 3, "0123456789") != name.size() - 3)
+      continue;
+
+    const std::string path = entry.path().string();
+    files_t files;
+    files.cpu = atoi(name.c_str() + 3);
+    files.frequency = open_attribute(path, "cpufreq/scaling_cur_freq");
+    files.core_throttles =
+        open_attribute(path, "thermal_throttle/core_throttle_count");
+    files.package_throttles =
+        open_attribute(path, "thermal_throttle/package_throttle_count");
+
+    uint64_t max = 0;
+    const int fd = open_attribute(path, "cpufreq/cpuinfo_max_freq");
+    read_number(fd, max);
+    if (fd >= 0)
+      close(fd);
+    files.max = max / 1000.0f;
+
+    m_frequency |= files.frequency >= 0;
+    m_throttling |= files.core_throttles >= 0 || files.package_throttles >= 0;
+    m_files.push_back(files);
+  }
+
+  std::sort(m_files.begin(), m_files.end(),
+            [](const files_t& a, const files_t& b) { return a.cpu < b.cpu; });
+}
+
+CpuFrequencies::~CpuFrequencies() {
+  for (const files_t& files : m_files) {
+    for (int fd :
+         {files.frequency, files.core_throttles, files.package_throttles}) {
+      if (fd >= 0)
+        close(fd);
+    }
+  }
+}
+
+bool CpuFrequencies::frequency() const { return m_frequency; }
+
+bool CpuFrequencies::throttling() const { return m_throttling; }
+
+void CpuFrequencies::read(std::vector<cpufreq_sample_t>& samples) const {
+  samples.resize(m_files.size());
+  for (size_t i = 0; i < m_files.size(); i++) {
+    const files_t& files = m_files[i];
+    cpufreq_sample_t& sample = samples[i];
+    sample.cpu = files.cpu;
+    sample.max = files.max;
+
+    uint64_t khz = 0;
+    sample.has_frequency = read_number(files.frequency, khz);
+    sample.frequency = khz / 1000.0f;
+
+    sample.core_throttles = 0;
+    sample.package_throttles = 0;
+    const bool core = read_number(files.core_throttles, sample.core_throttles);
+    const bool package =
+        read_number(files.package_throttles, sample.package_throttles);
+    sample.has_throttles = core || package;
+  }
+}
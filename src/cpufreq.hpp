@@ -0,0 +1,44 @@
+#ifndef __CPUFREQ_HPP__
+#define __CPUFREQ_HPP__
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+struct cpufreq_sample_t {
+  int cpu;
+  bool has_frequency;
+  float frequency; // MHz, scaling_cur_freq
+  float max;       // MHz, cpuinfo_max_freq
+  bool has_throttles;
+  uint64_t core_throttles; // thermal_throttle/core_throttle_count
+  uint64_t package_throttles;
+};
+
+// The cpufreq and thermal_throttle attributes of every CPU below root. They
+// are opened once and read with pread() at offset 0, CPUs going online later
+// are not picked up.
+class CpuFrequencies {
+public:
+  CpuFrequencies(const std::string& root = "/sys/devices/system/cpu");
+  ~CpuFrequencies();
+
+  bool frequency() const;  // Any CPU with cpufreq
+  bool throttling() const; // Any CPU with thermal_throttle (Intel)
+  void read(std::vector<cpufreq_sample_t>& samples) const;
+
+private:
+  struct files_t {
+    int cpu;
+    int frequency;
+    int core_throttles;
+    int package_throttles;
+    float max; // constant
+  };
+
+  std::vector<files_t> m_files;
+  bool m_frequency;
+  bool m_throttling;
+};
+
+#endif
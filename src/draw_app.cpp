@@ -2,21 +2,1219 @@
 
 typedef void (*DrawWindowCB)(std::shared_ptr<RefreshData>);
 
+static Heatmap cpu_heatmap(120);
+static Heatmap irq_heatmap(0, true);
+
+// Draws a placeholder for the sections whose first refresh is not done yet
+static bool draw_app_ready(bool ready) {
+  if (!ready)
+    ImGui::TextDisabled("Loading...");
+  return ready;
+}
+
+static bool draw_app_tab_ready(bool ready) {
+  if (!draw_app_ready(ready))
+    ImGui::EndTabItem();
+  return ready;
+}
+
+static void draw_app_graph_settings(RefreshData* data) {
+  bool changed = ImGui::Checkbox("Animate", &data->graph.animated);
+  changed |= ImGui::SliderFloat("FPS", &data->graph.fps, 1.0f, 60.0f);
+  ImGui::SliderFloat("Scale", &data->graph.yscale, 0.0f, 100.0f);
+
+  if (changed)
+    data->apply_graph_settings();
+}
+
+static void draw_app_sensors_tab(RefreshData* data) {
+  if (data->sensors.empty()) {
+    ImGui::TextDisabled("No sensor found");
+    return;
+  }
+
+  const auto now = std::chrono::steady_clock::now();
+
+  if (ImGui::BeginTable("##sensors", 7,
+                        ImGuiTableFlags_Resizable | ImGuiTableFlags_Borders |
+                            ImGuiTableFlags_ScrollY)) {
+    ImGui::TableSetupScrollFreeze(0, 1);
+    ImGui::TableSetupColumn("Device");
+    ImGui::TableSetupColumn("Sensor");
+    ImGui::TableSetupColumn("Value");
+    ImGui::TableSetupColumn("Age");
+    ImGui::TableSetupColumn("Latency");
+    ImGui::TableSetupColumn("Interval");
+    ImGui::TableSetupColumn("History");
+    ImGui::TableHeadersRow();
+
+    for (size_t i = 0; i < data->sensors.size(); i++) {
+      const sensor_t& sensor = data->sensors[i];
+
+      ImGui::TableNextRow();
+      ImGui::TableSetColumnIndex(0);
+      ImGui::Text("%s/%s", sensor.source.c_str(), sensor.device.c_str());
+
+      ImGui::TableSetColumnIndex(1);
+      ImGui::Text("%s", sensor.label.c_str());
+
+      ImGui::TableSetColumnIndex(2);
+      if (sensor.kind == SENSOR_STATUS)
+        ImGui::Text("%s", sensor.text.c_str());
+      else
+        ImGui::Text("%.2f %s", sensor.current, sensor.unit);
+
+      ImGui::TableSetColumnIndex(3);
+      const float age =
+          std::chrono::duration<float>(now - sensor.updated).count();
+      if (sensor.updated.time_since_epoch().count() == 0)
+        ImGui::TextDisabled("never");
+      else
+        ImGui::Text("%.1f s", age);
+
+      ImGui::TableSetColumnIndex(4);
+      ImGui::Text("%.2f ms", sensor.latency);
+
+      // Throttled sensors are highlighted
+      ImGui::TableSetColumnIndex(5);
+      if (sensor.interval > data->sensors_interval * 1.5f)
+        ImGui::TextColored(ImVec4(1.0f, 1.0f, 0.0f, 1.0f), "%.2f s",
+                           sensor.interval);
+      else
+        ImGui::Text("%.2f s", sensor.interval);
+
+      ImGui::TableSetColumnIndex(6);
+      if (sensor.kind != SENSOR_STATUS) {
+        char label[32];
+        snprintf(label, 32, "##sensor%d", (int)i);
+        ImGui::SetNextItemWidth(-FLT_MIN);
+        ImGui::PlotLines(label, sensor.values.data(), sensor.values.size());
+      }
+    }
+
+    ImGui::EndTable();
+  }
+}
+
+static void draw_app_perf_counters(RefreshData* data) {
+  static const char* hardware[] = {"IPC", "Cache miss %", "Branch miss %",
+                                   "Stalled %"};
+  static const char* software[] = {"Context switches/s", "Page faults/s",
+                                   "Migrations/s"};
+
+  const bool is_hardware = data->perf.mode == PERF_HARDWARE;
+  if (data->perf.mode == PERF_UNAVAILABLE) {
+    ImGui::TextDisabled("Performance counters unavailable: %s",
+                        strerror(data->perf.error));
+    return;
+  }
+
+  ImGui::Text("%s counters, average of the cores",
+              is_hardware ? "Hardware" : "Software (no hardware counters)");
+
+  const char** names = is_hardware ? hardware : software;
+  const int series = is_hardware ? 4 : 3;
+  for (int i = 0; i < series; i++) {
+    const std::array<float, 60>& values = data->perf.series[i];
+    char overlay[64];
+    snprintf(overlay, 64, "%s: %.2f", names[i], values.back());
+    ImGui::PlotLines(names[i], values.data(), values.size(), 0, overlay,
+                     0.0f, FLT_MAX, ImVec2(0, 40.0f));
+  }
+
+  if (!ImGui::TreeNode("Per core"))
+    return;
+
+  if (ImGui::BeginTable("##perf_cores", series + 1, ImGuiTableFlags_Borders)) {
+    ImGui::TableSetupColumn("Core");
+    for (int i = 0; i < series; i++)
+      ImGui::TableSetupColumn(names[i]);
+    ImGui::TableHeadersRow();
+
+    for (size_t core = 0; core < data->perf.cores.size(); core++) {
+      const perf_core_t& c = data->perf.cores[core];
+      const float hardware_values[] = {c.ipc, c.cache_miss, c.branch_miss,
+                                       c.stalled};
+      const float software_values[] = {c.context_switches, c.page_faults,
+                                       c.migrations};
+      const float* values = is_hardware ? hardware_values : software_values;
+
+      ImGui::TableNextRow();
+      ImGui::TableSetColumnIndex(0);
+      ImGui::Text("cpu%zu", core);
+      for (int i = 0; i < series; i++) {
+        ImGui::TableSetColumnIndex(i + 1);
+        ImGui::Text("%.2f", values[i]);
+      }
+    }
+
+    ImGui::EndTable();
+  }
+
+  ImGui::TreePop();
+}
+
+// Busy cores with tasks waiting on their run queue point at a bad affinity
+static void draw_app_run_queues(RefreshData* data) {
+  if (!ImGui::TreeNode("Run queues"))
+    return;
+
+  if (!data->run_queues.present) {
+    ImGui::TextDisabled("/proc/schedstat unavailable (CONFIG_SCHEDSTATS)");
+    ImGui::TreePop();
+    return;
+  }
+
+  if (ImGui::BeginTable("##run_queues", 6, ImGuiTableFlags_Borders)) {
+    ImGui::TableSetupColumn("Core");
+    ImGui::TableSetupColumn("Usage");
+    ImGui::TableSetupColumn("Running");
+    ImGui::TableSetupColumn("Waiting ms/s");
+    ImGui::TableSetupColumn("Latency per timeslice");
+    ImGui::TableSetupColumn("Timeslices/s");
+    ImGui::TableHeadersRow();
+
+    // Both list the online CPUs in the same order
+    const std::vector<float>& usage = data->cpu_cores.usage;
+    for (size_t i = 0; i < data->run_queues.cores.size(); i++) {
+      const run_queue_t& core = data->run_queues.cores[i];
+      ImGui::TableNextRow();
+      ImGui::TableSetColumnIndex(0);
+      ImGui::Text("cpu%d", core.cpu);
+      ImGui::TableSetColumnIndex(1);
+      if (i < usage.size())
+        ImGui::Text("%.0f%%", usage[i]);
+      ImGui::TableSetColumnIndex(2);
+      ImGui::Text("%.0f%%", core.running);
+      ImGui::TableSetColumnIndex(3);
+      // More than a tenth of the time, on average, spent waiting to run
+      if (core.waiting > 100.0f)
+        ImGui::TextColored(ImVec4(1.0f, 0.6f, 0.0f, 1.0f), "%.1f",
+                           core.waiting);
+      else
+        ImGui::Text("%.1f", core.waiting);
+      ImGui::TableSetColumnIndex(4);
+      ImGui::Text("%.0f us", core.latency);
+      ImGui::TableSetColumnIndex(5);
+      ImGui::Text("%.0f", core.timeslices);
+    }
+
+    ImGui::EndTable();
+  }
+
+  ImGui::TreePop();
+}
+
+// A busy core means little when it is throttled to half its frequency
+static void draw_app_cpufreq(RefreshData* data) {
+  if (!data->cpufreq.frequency && !data->cpufreq.throttling) {
+    ImGui::TextDisabled("No cpufreq nor thermal_throttle in sysfs");
+    return;
+  }
+
+  char overlay[64];
+  if (data->cpufreq.frequency) {
+    snprintf(overlay, 64, "Average: %.0f MHz", data->cpufreq.values.back());
+    ImGui::PlotLines("Frequency", data->cpufreq.values.data(),
+                     data->cpufreq.values.size(), 0, overlay, 0.0f,
+                     data->cpufreq.max > 0.0f ? data->cpufreq.max : FLT_MAX,
+                     ImVec2(0, 60.0f));
+  }
+  if (data->cpufreq.throttling) {
+    snprintf(overlay, 64, "Throttling: %.1f/s",
+             data->cpufreq.throttles.back());
+    ImGui::PlotLines("Throttling", data->cpufreq.throttles.data(),
+                     data->cpufreq.throttles.size(), 0, overlay, 0.0f,
+                     FLT_MAX, ImVec2(0, 40.0f));
+  }
+
+  if (!ImGui::TreeNode("Per core frequency"))
+    return;
+
+  if (ImGui::BeginTable("##cpufreq", 5, ImGuiTableFlags_Borders)) {
+    ImGui::TableSetupColumn("Core");
+    ImGui::TableSetupColumn("Frequency");
+    ImGui::TableSetupColumn("Of max");
+    ImGui::TableSetupColumn("Core throttles");
+    ImGui::TableSetupColumn("Package throttles");
+    ImGui::TableHeadersRow();
+
+    for (const core_frequency_t& core : data->cpufreq.cores) {
+      ImGui::TableNextRow();
+      ImGui::TableSetColumnIndex(0);
+      ImGui::Text("cpu%d", core.cpu);
+      ImGui::TableSetColumnIndex(1);
+      if (core.frequency > 0.0f)
+        ImGui::Text("%.0f MHz", core.frequency);
+      ImGui::TableSetColumnIndex(2);
+      if (core.max > 0.0f)
+        ImGui::Text("%.0f%%", 100.0f * core.frequency / core.max);
+      ImGui::TableSetColumnIndex(3);
+      if (core.throttle_rate > 0.0f)
+        ImGui::TextColored(ImVec4(1.0f, 0.3f, 0.3f, 1.0f), "%lu (%.1f/s)",
+                           core.core_throttles, core.throttle_rate);
+      else
+        ImGui::Text("%lu", core.core_throttles);
+      ImGui::TableSetColumnIndex(4);
+      ImGui::Text("%lu", core.package_throttles);
+    }
+
+    ImGui::EndTable();
+  }
+
+  ImGui::TreePop();
+}
+
+static void draw_app_power_tab(RefreshData* data) {
+  if (data->power.domains.empty()) {
+    if (data->power.error != 0)
+      ImGui::TextDisabled("RAPL energy counters unreadable: %s",
+                          strerror(data->power.error));
+    else
+      ImGui::TextDisabled("No RAPL zone in /sys/class/powercap");
+    return;
+  }
+
+  float total = 0.0f;
+  for (const power_domain_t& domain : data->power.domains) {
+    // The subzones are part of their package
+    if (domain.name.find('/') == std::string::npos)
+      total += domain.watts;
+  }
+  ImGui::Text("Packages: %.1f W", total);
+  if (data->power.error != 0)
+    ImGui::TextDisabled("Some zones unreadable: %s",
+                        strerror(data->power.error));
+
+  for (const power_domain_t& domain : data->power.domains) {
+    char overlay[64];
+    snprintf(overlay, 64, "%.1f W", domain.watts);
+    ImGui::PlotLines(domain.name.c_str(), domain.values.data(),
+                     domain.values.size(), 0, overlay, 0.0f, FLT_MAX,
+                     ImVec2(0, 60.0f));
+  }
+}
+
+static void draw_app_pressure_tab(RefreshData* data) {
+  if (!ImGui::BeginTable("##pressure", 7, ImGuiTableFlags_Borders))
+    return;
+
+  ImGui::TableSetupColumn("Resource");
+  ImGui::TableSetupColumn("Line");
+  ImGui::TableSetupColumn("Now");
+  ImGui::TableSetupColumn("Avg 10s");
+  ImGui::TableSetupColumn("Avg 60s");
+  ImGui::TableSetupColumn("Avg 300s");
+  ImGui::TableSetupColumn("Total");
+  ImGui::TableHeadersRow();
+
+  for (int i = 0; i < PRESSURE_RESOURCES; i++) {
+    const pressure_t& pressure = data->pressure[i];
+    const pressure_line_t* lines[] = {&pressure.current.some,
+                                      &pressure.current.full};
+    const float now[] = {pressure.some, pressure.full};
+
+    for (int j = 0; j < 2; j++) {
+      ImGui::TableNextRow();
+      ImGui::TableSetColumnIndex(0);
+      if (j == 0)
+        ImGui::Text("%s", pressure_name((pressure_resource_t)i));
+
+      ImGui::TableSetColumnIndex(1);
+      ImGui::Text("%s", j == 0 ? "some" : "full");
+
+      if (!pressure.present) {
+        ImGui::TableSetColumnIndex(2);
+        ImGui::TextDisabled("unavailable");
+        continue;
+      }
+
+      ImGui::TableSetColumnIndex(2);
+      ImGui::Text("%.2f%%", now[j]);
+      ImGui::TableSetColumnIndex(3);
+      ImGui::Text("%.2f%%", lines[j]->avg10);
+      ImGui::TableSetColumnIndex(4);
+      ImGui::Text("%.2f%%", lines[j]->avg60);
+      ImGui::TableSetColumnIndex(5);
+      ImGui::Text("%.2f%%", lines[j]->avg300);
+      ImGui::TableSetColumnIndex(6);
+      ImGui::Text("%.3f s", lines[j]->total / 1e6);
+    }
+  }
+
+  ImGui::EndTable();
+
+  for (int i = 0; i < PRESSURE_RESOURCES; i++) {
+    const pressure_t& pressure = data->pressure[i];
+    if (!pressure.present)
+      continue;
+
+    const char* name = pressure_name((pressure_resource_t)i);
+    ImGui::Separator();
+    if (pressure.armed)
+      ImGui::Text("%s: trigger fired %lu times", name, pressure.triggered);
+    else
+      ImGui::Text("%s: no trigger, sampled only", name);
+
+    char label[32], overlay[64];
+    snprintf(label, 32, "%s some", name);
+    snprintf(overlay, 64, "some: %.2f%%", pressure.some);
+    ImGui::PlotLines(label, pressure.some_values.data(),
+                     pressure.some_values.size(), 0, overlay, 0.0f, 100.0f,
+                     ImVec2(0, 60.0f));
+    snprintf(label, 32, "%s full", name);
+    snprintf(overlay, 64, "full: %.2f%%", pressure.full);
+    ImGui::PlotLines(label, pressure.full_values.data(),
+                     pressure.full_values.size(), 0, overlay, 0.0f, 100.0f,
+                     ImVec2(0, 60.0f));
+  }
+}
+
+static bool irq_less(const irq_source_t& a, const irq_source_t& b,
+                     int column) {
+  // Columns are in CPU order, sorting on them sorts on the CPU numbers
+  const auto busiest = [](const irq_source_t& s) {
+    return std::max_element(s.rates.begin(), s.rates.end()) - s.rates.begin();
+  };
+  const auto share = [](const irq_source_t& s) {
+    return s.total > 0.0f
+               ? *std::max_element(s.rates.begin(), s.rates.end()) / s.total
+               : 0.0f;
+  };
+
+  switch (column) {
+  case 1:
+    return a.total < b.total;
+  case 2:
+    return busiest(a) < busiest(b);
+  case 3:
+    return share(a) < share(b);
+  default:
+    // Numbered interrupts first, in order
+    if (isdigit(a.name[0]) && isdigit(b.name[0]))
+      return atoi(a.name.c_str()) < atoi(b.name.c_str());
+    if (isdigit(a.name[0]) != isdigit(b.name[0]))
+      return isdigit(a.name[0]);
+    return a.name < b.name;
+  }
+}
+
+// Number of the CPU of a column of the rates, offline CPUs leave gaps
+static int irq_cpu(const RefreshData* data, int column) {
+  const std::vector<int>& ids = data->interrupts.cpu_ids;
+  return column < (int)ids.size() ? ids[column] : column;
+}
+
+// Sources on Y, CPUs on X, each cell colored by its rate on a log scale. The
+// texture is only uploaded again when the rates or the rows shown change.
+static void draw_app_irq_matrix(RefreshData* data,
+                                const std::vector<const irq_source_t*>& rows) {
+  static std::vector<const irq_source_t*> uploaded;
+  const int cpus = data->interrupts.cpus;
+  if (rows.empty() || cpus <= 0)
+    return;
+
+  if (data->interrupts.generation != irq_heatmap.generation ||
+      rows != uploaded) {
+    float peak = 0.0f;
+    for (const irq_source_t* row : rows) {
+      for (float rate : row->rates)
+        peak = std::max(peak, rate);
+    }
+
+    // One column per CPU, a full pass brings the ring back to cpu0
+    irq_heatmap.resize(cpus);
+    std::vector<float> column(rows.size());
+    for (int cpu = 0; cpu < cpus; cpu++) {
+      for (size_t i = 0; i < rows.size(); i++)
+        column[i] = cpu < (int)rows[i]->rates.size() ? rows[i]->rates[cpu] : 0;
+      irq_heatmap.push_column(column.data(), column.size(), peak);
+    }
+
+    irq_heatmap.generation = data->interrupts.generation;
+    uploaded = rows;
+  }
+
+  const float label = ImGui::CalcTextSize("00000000").x;
+  const float cell_height = ImGui::GetTextLineHeight();
+  const ImVec2 origin = ImGui::GetCursorScreenPos();
+  const ImVec2 size(std::max(2.0f * cpus, ImGui::GetContentRegionAvail().x -
+                                              label),
+                    cell_height * rows.size());
+
+  ImDrawList* draw_list = ImGui::GetWindowDrawList();
+  for (size_t i = 0; i < rows.size(); i++)
+    draw_list->AddText(ImVec2(origin.x, origin.y + i * cell_height),
+                       ImGui::GetColorU32(ImGuiCol_Text),
+                       rows[i]->name.c_str());
+
+  ImGui::SetCursorScreenPos(ImVec2(origin.x + label, origin.y));
+  irq_heatmap.draw("##irq_matrix", size, nullptr);
+
+  if (ImGui::IsItemHovered()) {
+    const ImVec2 mouse = ImGui::GetIO().MousePos;
+    const int cpu = std::clamp(
+        (int)((mouse.x - origin.x - label) / size.x * cpus), 0, cpus - 1);
+    const int i = std::clamp((int)((mouse.y - origin.y) / cell_height), 0,
+                             (int)rows.size() - 1);
+    if (cpu < (int)rows[i]->rates.size())
+      ImGui::SetTooltip("%s on cpu%d: %.0f/s", rows[i]->name.c_str(),
+                        irq_cpu(data, cpu), rows[i]->rates[cpu]);
+  }
+}
+
+static void draw_app_interrupts_tab(RefreshData* data) {
+  if (ImGui::RadioButton("Interrupts", !data->interrupts.show_soft))
+    data->interrupts.show_soft = false;
+  ImGui::SameLine();
+  if (ImGui::RadioButton("Softirqs", data->interrupts.show_soft))
+    data->interrupts.show_soft = true;
+  ImGui::SameLine();
+  ImGui::Checkbox("Hide idle", &data->interrupts.hide_idle);
+  ImGui::SameLine();
+  ImGui::TextDisabled("(%zu rows changed)", data->interrupts.parsed);
+
+  const std::vector<irq_source_t>& sources = data->interrupts.show_soft
+                                                ? data->interrupts.soft
+                                                : data->interrupts.hard;
+  std::vector<const irq_source_t*> rows;
+  for (const irq_source_t& source : sources) {
+    if (!data->interrupts.hide_idle || source.total > 0.0f)
+      rows.push_back(&source);
+  }
+
+  // ImGui tables are limited to 64 columns, the CPUs are on the matrix below
+  if (ImGui::BeginTable("##interrupts", 6,
+                        ImGuiTableFlags_Resizable | ImGuiTableFlags_Borders |
+                            ImGuiTableFlags_Sortable | ImGuiTableFlags_ScrollY,
+                        ImVec2(0.0f, ImGui::GetTextLineHeightWithSpacing() *
+                                         12))) {
+    ImGui::TableSetupScrollFreeze(0, 1);
+    ImGui::TableSetupColumn("Source");
+    ImGui::TableSetupColumn("Total/s",
+                            ImGuiTableColumnFlags_DefaultSort |
+                                ImGuiTableColumnFlags_PreferSortDescending);
+    ImGui::TableSetupColumn("Busiest CPU");
+    ImGui::TableSetupColumn("Share",
+                            ImGuiTableColumnFlags_PreferSortDescending);
+    ImGui::TableSetupColumn("History", ImGuiTableColumnFlags_NoSort);
+    ImGui::TableSetupColumn("Description",
+                            ImGuiTableColumnFlags_NoSort |
+                                ImGuiTableColumnFlags_WidthStretch);
+    ImGui::TableHeadersRow();
+
+    const ImGuiTableSortSpecs* specs = ImGui::TableGetSortSpecs();
+    if (specs && specs->SpecsCount > 0) {
+      const ImGuiTableColumnSortSpecs sort = specs->Specs[0];
+      std::stable_sort(
+          rows.begin(), rows.end(),
+          [&sort](const irq_source_t* a, const irq_source_t* b) {
+            if (sort.SortDirection == ImGuiSortDirection_Descending)
+              return irq_less(*b, *a, sort.ColumnIndex);
+            return irq_less(*a, *b, sort.ColumnIndex);
+          });
+    }
+
+    for (const irq_source_t* row : rows) {
+      ImGui::TableNextRow();
+      ImGui::TableSetColumnIndex(0);
+      ImGui::Text("%s", row->name.c_str());
+      ImGui::TableSetColumnIndex(1);
+      ImGui::Text("%.0f", row->total);
+      if (row->total > 0.0f && !row->rates.empty()) {
+        const auto busiest =
+            std::max_element(row->rates.begin(), row->rates.end());
+        ImGui::TableSetColumnIndex(2);
+        ImGui::Text("cpu%d", irq_cpu(data, busiest - row->rates.begin()));
+        ImGui::TableSetColumnIndex(3);
+        ImGui::Text("%.0f%%", 100.0f * *busiest / row->total);
+      }
+      ImGui::TableSetColumnIndex(4);
+      ImGui::PushID(row->name.c_str());
+      ImGui::PlotLines("##history", row->values.data(), row->values.size(), 0,
+                       nullptr, 0.0f, FLT_MAX,
+                       ImVec2(-FLT_MIN, ImGui::GetTextLineHeight()));
+      ImGui::PopID();
+      ImGui::TableSetColumnIndex(5);
+      ImGui::Text("%s", row->description.c_str());
+    }
+
+    ImGui::EndTable();
+  }
+
+  ImGui::Text("Per CPU rates");
+  draw_app_irq_matrix(data, rows);
+}
+
+static void draw_app_collectors_tab(RefreshData* data) {
+  static const char* costs[] = {"Cheap", "Moderate", "Expensive"};
+
+  if (ImGui::BeginTable("##collectors", 6,
+                        ImGuiTableFlags_Resizable | ImGuiTableFlags_Borders)) {
+    ImGui::TableSetupColumn("Collector");
+    ImGui::TableSetupColumn("Cost");
+    ImGui::TableSetupColumn("Interval");
+    ImGui::TableSetupColumn("Last run");
+    ImGui::TableSetupColumn("Runs");
+    ImGui::TableSetupColumn("Overruns");
+    ImGui::TableHeadersRow();
+
+    const std::vector<collector_t> collectors = data->scheduler->collectors();
+    for (size_t i = 0; i < collectors.size(); i++) {
+      const collector_t& collector = collectors[i];
+
+      ImGui::TableNextRow();
+      ImGui::TableSetColumnIndex(0);
+      ImGui::Text("%s", collector.name.c_str());
+
+      ImGui::TableSetColumnIndex(1);
+      ImGui::Text("%s", costs[collector.cost]);
+
+      ImGui::TableSetColumnIndex(2);
+      // Driven by the "Animate" and "FPS" settings, which would overwrite
+      // any interval set here
+      const bool graph = (int)i == data->collectors.cpu_graph ||
+                         (int)i == data->collectors.sensors;
+      if (collector.one_shot) {
+        ImGui::TextDisabled("once");
+      } else if (graph) {
+        if (collector.interval > 0.0f)
+          ImGui::TextDisabled("%.3f s", collector.interval);
+        else
+          ImGui::TextDisabled("paused");
+        if (ImGui::IsItemHovered())
+          ImGui::SetTooltip("Set by Animate and FPS");
+      } else {
+        char label[32];
+        snprintf(label, 32, "##interval%d", (int)i);
+        float interval = collector.interval;
+        ImGui::SetNextItemWidth(-FLT_MIN);
+        if (ImGui::SliderFloat(label, &interval, 0.0f, 60.0f,
+                               interval > 0.0f ? "%.3f s" : "paused",
+                               ImGuiSliderFlags_Logarithmic))
+          data->scheduler->set_interval(i, interval);
+      }
+
+      ImGui::TableSetColumnIndex(3);
+      ImGui::Text("%.2f ms", collector.duration);
+
+      ImGui::TableSetColumnIndex(4);
+      ImGui::Text("%lu", collector.runs);
+
+      ImGui::TableSetColumnIndex(5);
+      ImGui::Text("%lu", collector.overruns);
+    }
+
+    ImGui::EndTable();
+  }
+
+  ImGui::Text("Processes: %lu files read in %lu syscalls (%s), %lu shards "
+              "on %d threads",
+              data->processes.files, data->processes.syscalls,
+              data->processes.uring ? "io_uring" : "read",
+              data->processes.shards, data->scan_workers);
+}
+
+enum {
+  PROCESS_COLUMN_PID,
+  PROCESS_COLUMN_NAME,
+  PROCESS_COLUMN_STATE,
+  PROCESS_COLUMN_CPU,
+  PROCESS_COLUMN_MEM,
+  PROCESS_COLUMN_LAST_CPU,
+  PROCESS_COLUMN_MINFLT,
+  PROCESS_COLUMN_MAJFLT,
+  PROCESS_COLUMN_BLKIO,
+  PROCESS_COLUMN_READ,
+  PROCESS_COLUMN_WRITE,
+  PROCESS_COLUMN_RUN,
+  PROCESS_COLUMN_WAIT,
+  PROCESS_COLUMN_TIMESLICES,
+  PROCESS_COLUMN_VOLUNTARY,
+  PROCESS_COLUMN_NONVOLUNTARY,
+  PROCESS_COLUMN_WAIT_HISTORY,
+  PROCESS_COLUMN_NONVOLUNTARY_HISTORY,
+  PROCESS_COLUMNS,
+};
+
+static bool process_less(const process_t& a, const process_t& b, int column) {
+  switch (column) {
+  case PROCESS_COLUMN_NAME:
+    return a.name < b.name;
+  case PROCESS_COLUMN_STATE:
+    return a.state < b.state;
+  case PROCESS_COLUMN_CPU:
+    return a.cpu < b.cpu;
+  case PROCESS_COLUMN_MEM:
+    return a.mem < b.mem;
+  case PROCESS_COLUMN_LAST_CPU:
+    return a.pstat1.processor < b.pstat1.processor;
+  case PROCESS_COLUMN_MINFLT:
+    return a.minflt_rate < b.minflt_rate;
+  case PROCESS_COLUMN_MAJFLT:
+    return a.majflt_rate < b.majflt_rate;
+  case PROCESS_COLUMN_BLKIO:
+    return a.blkio_rate < b.blkio_rate;
+  case PROCESS_COLUMN_READ:
+    return a.read_rate < b.read_rate;
+  case PROCESS_COLUMN_WRITE:
+    return a.write_rate < b.write_rate;
+  case PROCESS_COLUMN_RUN:
+    return a.run_rate < b.run_rate;
+  case PROCESS_COLUMN_WAIT:
+  case PROCESS_COLUMN_WAIT_HISTORY:
+    return a.wait_rate < b.wait_rate;
+  case PROCESS_COLUMN_TIMESLICES:
+    return a.timeslices_rate < b.timeslices_rate;
+  case PROCESS_COLUMN_VOLUNTARY:
+    return a.voluntary_rate < b.voluntary_rate;
+  case PROCESS_COLUMN_NONVOLUNTARY:
+  case PROCESS_COLUMN_NONVOLUNTARY_HISTORY:
+    return a.nonvoluntary_rate < b.nonvoluntary_rate;
+  default:
+    return a.pid < b.pid;
+  }
+}
+
+static void draw_app_memory_details(RefreshData* data) {
+  if (data->processes_selection.empty())
+    ImGui::TextDisabled("Top processes by memory usage, select processes to "
+                        "inspect them instead");
+
+  if (!ImGui::BeginTable("##memory_details", 9,
+                         ImGuiTableFlags_Resizable | ImGuiTableFlags_Borders))
+    return;
+
+  ImGui::TableSetupColumn("Pid");
+  ImGui::TableSetupColumn("Name");
+  ImGui::TableSetupColumn("RSS");
+  ImGui::TableSetupColumn("PSS");
+  ImGui::TableSetupColumn("USS");
+  ImGui::TableSetupColumn("Swap");
+  ImGui::TableSetupColumn("Anonymous");
+  ImGui::TableSetupColumn("File");
+  ImGui::TableSetupColumn("Age");
+  ImGui::TableHeadersRow();
+
+  const auto now = std::chrono::steady_clock::now();
+  for (const auto& entry : data->processes.details) {
+    const memory_detail_t& detail = entry.second;
+    const smaps_rollup_t& smaps = detail.smaps;
+
+    ImGui::TableNextRow();
+    ImGui::TableSetColumnIndex(0);
+    ImGui::Text("%d", entry.first);
+
+    ImGui::TableSetColumnIndex(1);
+    fonts_request(detail.name.c_str());
+    ImGui::Text("%s", detail.name.c_str());
+
+    ImGui::TableSetColumnIndex(8);
+    if (detail.updated == std::chrono::steady_clock::time_point{}) {
+      ImGui::TextDisabled("Loading...");
+      continue;
+    }
+    const std::chrono::duration<float> age = now - detail.updated;
+    ImGui::Text("%.0f s (%.1f ms)", age.count(), detail.latency);
+    if (!detail.success) {
+      ImGui::TableSetColumnIndex(2);
+      ImGui::TextDisabled("unavailable");
+      continue;
+    }
+
+    const uint64_t values[] = {
+        smaps.rss,
+        smaps.pss,
+        smaps.private_clean + smaps.private_dirty,
+        smaps.swap,
+        smaps.anonymous,
+        smaps.rss - std::min(smaps.rss, smaps.anonymous),
+    };
+    for (int i = 0; i < 6; i++) {
+      ImGui::TableSetColumnIndex(2 + i);
+      ImGui::Text("%s", human_readable(values[i]).c_str());
+    }
+  }
+
+  ImGui::EndTable();
+}
+
+// Icicle layout: the root on top and the callees under their callers, the
+// width of each frame is its share of the samples
+static void draw_app_flame_graph(const std::vector<profile_node_t>& nodes) {
+  if (nodes.empty() || nodes[0].value == 0)
+    return;
+
+  int depth = 0;
+  for (const profile_node_t& node : nodes)
+    depth = std::max(depth, node.depth);
+
+  const float row = ImGui::GetTextLineHeightWithSpacing();
+  const ImVec2 origin = ImGui::GetCursorScreenPos();
+  const float width = ImGui::GetContentRegionAvail().x;
+  ImGui::InvisibleButton("##flame_graph", ImVec2(width, row * (depth + 1)));
+  const bool hovered = ImGui::IsItemHovered();
+  const ImVec2 mouse = ImGui::GetIO().MousePos;
+
+  ImDrawList* draw_list = ImGui::GetWindowDrawList();
+  const float scale = width / nodes[0].value;
+  // Next free position under each node, the children follow their parent
+  std::vector<float> cursor(nodes.size());
+  for (size_t i = 0; i < nodes.size(); i++) {
+    const profile_node_t& node = nodes[i];
+    const float x = node.parent < 0 ? origin.x : cursor[node.parent];
+    const float w = node.value * scale;
+    cursor[i] = x;
+    if (node.parent >= 0)
+      cursor[node.parent] += w;
+    if (w < 1.0f)
+      continue;
+
+    const ImVec2 min(x, origin.y + node.depth * row);
+    const ImVec2 max(x + w - 1.0f, min.y + row - 1.0f);
+    const size_t hash = std::hash<std::string>()(node.name);
+    draw_list->AddRectFilled(
+        min, max,
+        ImColor::HSV((hash % 40) / 360.0f, 0.5f + (hash >> 8) % 30 / 100.0f,
+                     0.95f));
+    if (w > ImGui::GetFontSize()) {
+      draw_list->PushClipRect(min, max, true);
+      draw_list->AddText(ImVec2(min.x + 2.0f, min.y), IM_COL32_BLACK,
+                         node.name.c_str());
+      draw_list->PopClipRect();
+    }
+
+    if (hovered && mouse.x >= min.x && mouse.x < max.x && mouse.y >= min.y &&
+        mouse.y < max.y)
+      ImGui::SetTooltip("%s\n%lu samples (%.1f%%)", node.name.c_str(),
+                        node.value, 100.0f * node.value / nodes[0].value);
+  }
+}
+
+static void draw_app_profile(RefreshData* data) {
+  if (data->profile.running) {
+    const std::chrono::duration<float> elapsed =
+        std::chrono::steady_clock::now() - data->profile.started;
+    char overlay[64];
+    snprintf(overlay, sizeof(overlay), "Sampling %d...", data->profile.pid);
+    ImGui::ProgressBar(
+        std::min(1.0f, elapsed.count() / data->profile.seconds),
+        ImVec2(0.0f, 0.0f), overlay);
+    return;
+  }
+
+  if (!data->profile.ready) {
+    ImGui::TextDisabled("Select a process and press Profile");
+    return;
+  }
+
+  const profile_t& profile = data->profile.result;
+  if (!profile.error.empty()) {
+    ImGui::TextColored(ImVec4(1.0f, 0.3f, 0.3f, 1.0f), "%d %s: %s",
+                       profile.pid, profile.name.c_str(),
+                       profile.error.c_str());
+    return;
+  }
+
+  ImGui::Text("%d %s: %lu samples of %d threads over %.1f s", profile.pid,
+              profile.name.c_str(), profile.samples, profile.threads,
+              profile.duration);
+  if (profile.lost > 0) {
+    ImGui::SameLine();
+    ImGui::TextColored(ImVec4(1.0f, 0.6f, 0.0f, 1.0f), "(%lu lost)",
+                       profile.lost);
+  }
+  if (profile.samples == 0)
+    return;
+
+  if (ImGui::BeginTable("##profile_functions", 3,
+                        ImGuiTableFlags_Resizable | ImGuiTableFlags_Borders |
+                            ImGuiTableFlags_ScrollY,
+                        ImVec2(0.0f, ImGui::GetTextLineHeightWithSpacing() *
+                                         12))) {
+    ImGui::TableSetupScrollFreeze(0, 1);
+    ImGui::TableSetupColumn("Self");
+    ImGui::TableSetupColumn("Total");
+    ImGui::TableSetupColumn("Function", ImGuiTableColumnFlags_WidthStretch);
+    ImGui::TableHeadersRow();
+
+    const size_t count = std::min<size_t>(100, profile.functions.size());
+    for (size_t i = 0; i < count; i++) {
+      const profile_function_t& function = profile.functions[i];
+      ImGui::TableNextRow();
+      ImGui::TableSetColumnIndex(0);
+      ImGui::Text("%.1f%%", 100.0f * function.self / profile.samples);
+      ImGui::TableSetColumnIndex(1);
+      ImGui::Text("%.1f%%", 100.0f * function.total / profile.samples);
+      ImGui::TableSetColumnIndex(2);
+      ImGui::Text("%s", function.name.c_str());
+    }
+    ImGui::EndTable();
+  }
+
+  draw_app_flame_graph(profile.flame);
+}
+
+// The swap bar tells how much is swapped out, these tell whether the
+// machine is thrashing right now
+static void draw_app_vmstat(RefreshData* data) {
+  static const struct {
+    vmstat_counter_t counter;
+    const char* format;
+    bool alarming; // plotted in red while non zero
+  } plots[] = {
+      {VMSTAT_SWAP_IN, "Swap in: %.0f pages/s", true},
+      {VMSTAT_SWAP_OUT, "Swap out: %.0f pages/s", true},
+      {VMSTAT_MAJOR_FAULTS, "Major faults: %.0f/s", false},
+      {VMSTAT_SCANNED, "Scanned: %.0f pages/s", false},
+      {VMSTAT_STOLEN, "Stolen: %.0f pages/s", false},
+      {VMSTAT_DIRTY, "Dirty: %.0f pages", false},
+      {VMSTAT_WRITEBACK, "Writeback: %.0f pages", false},
+      {VMSTAT_THP_ALLOC, "THP allocated: %.0f/s", false},
+      {VMSTAT_THP_FALLBACK, "THP fallbacks: %.0f/s", true},
+  };
+
+  if (!data->vmstat.present ||
+      !ImGui::BeginTable("##vmstat", 3, ImGuiTableFlags_SizingStretchSame))
+    return;
+
+  for (const auto& plot : plots) {
+    ImGui::TableNextColumn();
+    const float current = data->vmstat.current[plot.counter];
+    const std::array<float, 60>& values = data->vmstat.values[plot.counter];
+
+    char overlay[64];
+    snprintf(overlay, 64, plot.format, current);
+    const bool alarm = plot.alarming && current > 0.0f;
+    if (alarm)
+      ImGui::PushStyleColor(ImGuiCol_PlotLines,
+                            ImVec4(1.0f, 0.3f, 0.3f, 1.0f));
+    ImGui::PushID(plot.counter);
+    ImGui::PlotLines("##vmstat", values.data(), values.size(), 0, overlay,
+                     0.0f, FLT_MAX, ImVec2(-FLT_MIN, 30.0f));
+    ImGui::PopID();
+    if (alarm)
+      ImGui::PopStyleColor();
+  }
+
+  ImGui::EndTable();
+}
+
+static bool slab_less(const slab_cache_t& a, const slab_cache_t& b,
+                      int column) {
+  switch (column) {
+  case 1:
+    return a.active_objects < b.active_objects;
+  case 2:
+    return a.bytes < b.bytes;
+  case 3:
+    return a.growth < b.growth;
+  default:
+    return a.name < b.name;
+  }
+}
+
+// Kernel memory leaks such as dentry or inode growth do not show in the
+// used memory, the caches growing the fastest are listed first
+static void draw_app_slabs(RefreshData* data) {
+  if (!data->slabs.present) {
+    ImGui::TextDisabled("/proc/slabinfo unreadable: %s%s",
+                        strerror(data->slabs.error),
+                        data->slabs.error == EACCES ? " (needs root)" : "");
+    return;
+  }
+
+  ImGui::Text("%s in %zu caches, growth over %.0f s",
+              human_readable(data->slabs.bytes).c_str(),
+              data->slabs.caches.size(), data->slabs.window);
+
+  if (!ImGui::BeginTable("##slabs", 5,
+                         ImGuiTableFlags_Resizable | ImGuiTableFlags_Borders |
+                             ImGuiTableFlags_Sortable |
+                             ImGuiTableFlags_ScrollY,
+                         ImVec2(0.0f,
+                                ImGui::GetTextLineHeightWithSpacing() * 16)))
+    return;
+
+  ImGui::TableSetupScrollFreeze(0, 1);
+  ImGui::TableSetupColumn("Cache");
+  ImGui::TableSetupColumn("Objects",
+                          ImGuiTableColumnFlags_PreferSortDescending);
+  ImGui::TableSetupColumn("Memory",
+                          ImGuiTableColumnFlags_PreferSortDescending);
+  ImGui::TableSetupColumn("Growth/s",
+                          ImGuiTableColumnFlags_DefaultSort |
+                              ImGuiTableColumnFlags_PreferSortDescending);
+  ImGui::TableSetupColumn("History", ImGuiTableColumnFlags_NoSort);
+  ImGui::TableHeadersRow();
+
+  std::vector<const slab_cache_t*> caches;
+  for (const slab_cache_t& cache : data->slabs.caches)
+    caches.push_back(&cache);
+
+  const ImGuiTableSortSpecs* specs = ImGui::TableGetSortSpecs();
+  if (specs && specs->SpecsCount > 0) {
+    const ImGuiTableColumnSortSpecs sort = specs->Specs[0];
+    std::stable_sort(
+        caches.begin(), caches.end(),
+        [&sort](const slab_cache_t* a, const slab_cache_t* b) {
+          if (sort.SortDirection == ImGuiSortDirection_Descending)
+            return slab_less(*b, *a, sort.ColumnIndex);
+          return slab_less(*a, *b, sort.ColumnIndex);
+        });
+  }
+
+  for (const slab_cache_t* cache : caches) {
+    ImGui::TableNextRow();
+    ImGui::TableSetColumnIndex(0);
+    ImGui::Text("%s", cache->name.c_str());
+    ImGui::TableSetColumnIndex(1);
+    ImGui::Text("%lu / %lu", cache->active_objects, cache->objects);
+    ImGui::TableSetColumnIndex(2);
+    ImGui::Text("%s / %s", human_readable(cache->active_bytes).c_str(),
+                human_readable(cache->bytes).c_str());
+    ImGui::TableSetColumnIndex(3);
+    const uint64_t growth = fabsf(cache->growth);
+    if (cache->growth > 0.0f)
+      ImGui::TextColored(ImVec4(1.0f, 0.6f, 0.0f, 1.0f), "+%s",
+                         human_readable(growth).c_str());
+    else if (cache->growth < 0.0f)
+      ImGui::Text("-%s", human_readable(growth).c_str());
+    ImGui::TableSetColumnIndex(4);
+    ImGui::PushID(cache->name.c_str());
+    const int samples = cache->samples;
+    ImGui::PlotLines("##history",
+                     cache->values.data() + cache->values.size() - samples,
+                     samples, 0, nullptr, FLT_MAX, FLT_MAX,
+                     ImVec2(-FLT_MIN, ImGui::GetTextLineHeight()));
+    ImGui::PopID();
+  }
+
+  ImGui::EndTable();
+}
+
+static void draw_app_numa(RefreshData* data) {
+  if (data->numa.nodes.empty()) {
+    ImGui::TextDisabled("No NUMA node in sysfs");
+    return;
+  }
+
+  if (ImGui::BeginTable("##numa_nodes", 9, ImGuiTableFlags_Borders)) {
+    ImGui::TableSetupColumn("Node");
+    ImGui::TableSetupColumn("Total");
+    ImGui::TableSetupColumn("Free");
+    ImGui::TableSetupColumn("File");
+    ImGui::TableSetupColumn("Anonymous");
+    ImGui::TableSetupColumn("Hit/s");
+    ImGui::TableSetupColumn("Miss/s");
+    ImGui::TableSetupColumn("Foreign/s");
+    ImGui::TableSetupColumn("Remote/s");
+    ImGui::TableHeadersRow();
+
+    for (const numa_node_t& node : data->numa.nodes) {
+      const numa_node_stat_t& stat = node.stat;
+      ImGui::TableNextRow();
+      ImGui::TableSetColumnIndex(0);
+      ImGui::Text("node%d", stat.node);
+
+      const uint64_t sizes[] = {stat.mem_total, stat.mem_free, stat.file_pages,
+                                stat.anon_pages};
+      for (int i = 0; i < 4; i++) {
+        ImGui::TableSetColumnIndex(1 + i);
+        ImGui::Text("%s", human_readable(sizes[i]).c_str());
+      }
+
+      // In pages: allocations which did not land on the intended node
+      const float rates[] = {node.hit_rate, node.miss_rate, node.foreign_rate,
+                             node.other_rate};
+      for (int i = 0; i < 4; i++) {
+        ImGui::TableSetColumnIndex(5 + i);
+        if (i > 0 && rates[i] > 0.0f)
+          ImGui::TextColored(ImVec4(1.0f, 0.6f, 0.0f, 1.0f), "%.0f", rates[i]);
+        else
+          ImGui::Text("%.0f", rates[i]);
+      }
+    }
+
+    ImGui::EndTable();
+  }
+
+  const numa_placement_t& placement = data->numa.placement;
+  ImGui::BeginDisabled(data->processes_selection.size() != 1 ||
+                       placement.pending);
+  if (ImGui::Button("Read placement of the selected process")) {
+    const pid_t pid = data->processes_selection.front();
+    std::string name;
+    for (const process_t& process : data->processes.processes) {
+      if (process.pid == pid)
+        name = process.name;
+    }
+    data->read_numa_maps_async(pid, name);
+  }
+  ImGui::EndDisabled();
+
+  if (placement.pid == 0)
+    return;
+  if (placement.pending) {
+    ImGui::TextDisabled("Reading /proc/%d/numa_maps...", placement.pid);
+    return;
+  }
+  if (!placement.success) {
+    ImGui::TextDisabled("%d %s: numa_maps unavailable", placement.pid,
+                        placement.name.c_str());
+    return;
+  }
+
+  uint64_t total = 0;
+  for (const auto& node : placement.nodes)
+    total += node.second;
+  ImGui::Text("%d %s: %s mapped (%.1f ms)", placement.pid,
+              placement.name.c_str(), human_readable(total).c_str(),
+              placement.latency);
+  for (const auto& node : placement.nodes) {
+    char overlay[64];
+    snprintf(overlay, 64, "node%d: %s", node.first,
+             human_readable(node.second).c_str());
+    ImGui::ProgressBar(total > 0 ? (float)node.second / total : 0.0f,
+                       ImVec2(-FLT_MIN, 0.0f), overlay);
+  }
+}
+
+// Draws the cgroup at index and its subtree, returns the index following it
+static size_t
+draw_app_cgroup(RefreshData* data,
+                const std::unordered_map<pid_t, const char*>& names,
+                size_t index) {
+  const std::vector<cgroup_t>& tree = data->cgroups.tree;
+  const cgroup_t& cgroup = tree[index];
+
+  size_t end = index + 1;
+  while (end < tree.size() && tree[end].depth > cgroup.depth)
+    end++;
+  // Without the pids controller the membership is unknown until expanded
+  const bool leaf = end == index + 1 &&
+                    cgroup.stat.present[CGROUP_PIDS_CURRENT] &&
+                    cgroup.stat.pids_current == 0;
+
+  ImGui::TableNextRow();
+  ImGui::TableSetColumnIndex(0);
+  const bool open = ImGui::TreeNodeEx(
+      cgroup.path.empty() ? "/" : cgroup.path.c_str(),
+      ImGuiTreeNodeFlags_SpanFullWidth | (leaf ? ImGuiTreeNodeFlags_Leaf : 0),
+      "%s", cgroup.name.c_str());
+
+  // Membership is only read for the expanded cgroups
+  if (open != (data->cgroups.expanded.count(cgroup.path) != 0)) {
+    if (open)
+      data->cgroups.expanded.insert(cgroup.path);
+    else
+      data->cgroups.expanded.erase(cgroup.path);
+  }
+
+  ImGui::TableSetColumnIndex(1);
+  ImGui::Text("%.1f%%", cgroup.cpu);
+  ImGui::TableSetColumnIndex(2);
+  if (cgroup.stat.nr_throttled > 0)
+    ImGui::Text("%.1f%%", cgroup.throttled);
+  ImGui::TableSetColumnIndex(3);
+  if (cgroup.stat.present[CGROUP_MEMORY_CURRENT])
+    ImGui::Text("%s", human_readable(cgroup.stat.memory_current).c_str());
+  ImGui::TableSetColumnIndex(4);
+  if (cgroup.stat.present[CGROUP_IO_STAT])
+    ImGui::Text("%s / %s", human_readable(cgroup.read_rate).c_str(),
+                human_readable(cgroup.write_rate).c_str());
+  ImGui::TableSetColumnIndex(5);
+  if (cgroup.stat.present[CGROUP_PIDS_CURRENT])
+    ImGui::Text("%lu", cgroup.stat.pids_current);
+  ImGui::TableSetColumnIndex(6);
+  if (cgroup.stat.oom_kill > 0)
+    ImGui::TextColored(ImVec4(1.0f, 0.3f, 0.3f, 1.0f), "%lu",
+                       cgroup.stat.oom_kill);
+  ImGui::TableSetColumnIndex(7);
+  ImGui::PushID(cgroup.path.c_str());
+  ImGui::PlotLines("##cpu", cgroup.cpu_values.data(),
+                   cgroup.cpu_values.size(), 0, nullptr, 0.0f, FLT_MAX,
+                   ImVec2(-FLT_MIN, ImGui::GetTextLineHeight()));
+  ImGui::PopID();
+
+  if (!open)
+    return end;
+
+  for (size_t child = index + 1; child < end;)
+    child = draw_app_cgroup(data, names, child);
+
+  for (pid_t pid : cgroup.procs) {
+    ImGui::TableNextRow();
+    ImGui::TableSetColumnIndex(0);
+    const auto name = names.find(pid);
+    ImGui::TreeNodeEx((void*)(intptr_t)pid,
+                      ImGuiTreeNodeFlags_Leaf |
+                          ImGuiTreeNodeFlags_NoTreePushOnOpen,
+                      "%d %s", pid, name != names.end() ? name->second : "");
+  }
+
+  ImGui::TreePop();
+  return end;
+}
+
+static void draw_app_cgroups(RefreshData* data) {
+  if (data->cgroups.root.empty()) {
+    ImGui::TextDisabled("No cgroup v2 hierarchy mounted");
+    return;
+  }
+
+  ImGui::Text("%s: %zu cgroups%s", data->cgroups.root.c_str(),
+              data->cgroups.tree.size(),
+              data->cgroups.inotify ? "" : " (rescanned on every refresh)");
+  if (data->cgroups.tree.empty())
+    return;
+
+  std::unordered_map<pid_t, const char*> names;
+  if (!data->cgroups.expanded.empty()) {
+    for (const process_t& process : data->processes.processes)
+      names[process.pid] = process.name.c_str();
+  }
+
+  if (ImGui::BeginTable("##cgroups", 8,
+                        ImGuiTableFlags_Resizable | ImGuiTableFlags_Borders)) {
+    ImGui::TableSetupColumn("Cgroup");
+    ImGui::TableSetupColumn("CPU");
+    ImGui::TableSetupColumn("Throttled");
+    ImGui::TableSetupColumn("Memory");
+    ImGui::TableSetupColumn("Read / Write per s");
+    ImGui::TableSetupColumn("Pids");
+    ImGui::TableSetupColumn("OOM kills");
+    ImGui::TableSetupColumn("CPU history");
+    ImGui::TableHeadersRow();
+
+    draw_app_cgroup(data, names, 0);
+
+    ImGui::EndTable();
+  }
+}
+
 void draw_app_system_window(std::shared_ptr<RefreshData> data) {
-  ImGui::Text("Operating System: %s", data->operating_system.c_str());
-  ImGui::Text("Hostname: %s", data->hostname.c_str());
-  ImGui::Text("User: %s", data->user.c_str());
-  ImGui::Text("Working processes: %d", data->processes.processes.size());
-  ImGui::Text("CPU: %s", data->cpu_info.c_str());
+  // Upload the new column even when the CPU tab is hidden to keep the history
+  if (data->cpu_cores.generation != cpu_heatmap.generation) {
+    cpu_heatmap.push_column(data->cpu_cores.usage.data(),
+                            data->cpu_cores.usage.size(), data->graph.yscale);
+    cpu_heatmap.generation = data->cpu_cores.generation;
+  }
+
+  if (draw_app_ready(data->ready.system)) {
+    ImGui::Text("Operating System: %s", data->operating_system.c_str());
+    ImGui::Text("Hostname: %s", data->hostname.c_str());
+    ImGui::Text("User: %s", data->user.c_str());
+    ImGui::Text("Working processes: %d", data->processes.processes.size());
+    ImGui::Text("CPU: %s", data->cpu_info.c_str());
+  }
 
   ImGui::Separator();
 
   if (ImGui::BeginTabBar("##Tabs", 0)) {
 
-    if (ImGui::BeginTabItem("CPU")) {
-      ImGui::Checkbox("Animate", &data->graph.animated);
-      ImGui::SliderFloat("FPS", &data->graph.fps, 1.0f, 60.0f);
-      ImGui::SliderFloat("Scale", &data->graph.yscale, 0.0f, 100.0f);
+    if (ImGui::BeginTabItem("CPU") && draw_app_tab_ready(data->ready.cpu)) {
+      draw_app_graph_settings(data.get());
 
       ImGui::Separator();
 
@@ -28,21 +1226,57 @@ void draw_app_system_window(std::shared_ptr<RefreshData> data) {
                        data->cpu_graph.values.size(), 0, overlay, 0,
                        data->graph.yscale, ImVec2(0, 160.0f));
 
+      const pressure_t& pressure = data->pressure[PRESSURE_CPU];
+      if (pressure.present) {
+        sprintf(overlay, "Pressure: some %.2f%%", pressure.some);
+        ImGui::PlotLines("CPU pressure", pressure.some_values.data(),
+                         pressure.some_values.size(), 0, overlay, 0.0f, 100.0f,
+                         ImVec2(0, 40.0f));
+      }
+
+      ImGui::Separator();
+
+      const int cores = data->cpu_cores.usage.size();
+      ImGui::Text("Per-core usage (%d cores)", cores);
+      cpu_heatmap.draw("##cpu_heatmap",
+                       ImVec2(ImGui::GetContentRegionAvail().x,
+                              std::clamp(cores * 4.0f, 64.0f, 256.0f)),
+                       "cpu%d: %.0f%%");
+      draw_app_run_queues(data.get());
+
+      ImGui::Separator();
+      draw_app_perf_counters(data.get());
+
       ImGui::EndTabItem();
     }
 
-    if (ImGui::BeginTabItem("Battery")) {
-      ImGui::Text("Status: %s", data->battery.status.c_str());
-      ImGui::Text("Capacity: %d A/h [%d mA/h]", data->battery.now / 1000,
-                  data->battery.full);
-      ImGui::Text("Current charge: %d A/h [%d mA/h]", data->battery.now / 1000,
-                  data->battery.now);
+    if (ImGui::BeginTabItem("Pressure") &&
+        draw_app_tab_ready(data->ready.pressure)) {
+      draw_app_pressure_tab(data.get());
+      ImGui::EndTabItem();
+    }
+
+    if (ImGui::BeginTabItem("Interrupts") &&
+        draw_app_tab_ready(data->ready.cpu)) {
+      draw_app_interrupts_tab(data.get());
+      ImGui::EndTabItem();
+    }
+
+    if (ImGui::BeginTabItem("Battery") &&
+        draw_app_tab_ready(data->ready.sensors)) {
+      if (data->battery.present) {
+        ImGui::Text("Status: %s", data->battery.status.c_str());
+        ImGui::Text("Capacity: %.2f %s", data->battery.full,
+                    data->battery.unit);
+        ImGui::Text("Current charge: %.2f %s", data->battery.now,
+                    data->battery.unit);
+      } else {
+        ImGui::TextDisabled("No battery found");
+      }
 
       ImGui::Separator();
 
-      ImGui::Checkbox("Animate", &data->graph.animated);
-      ImGui::SliderFloat("FPS", &data->graph.fps, 1.0f, 60.0f);
-      ImGui::SliderFloat("Scale", &data->graph.yscale, 0.0f, 100.0f);
+      draw_app_graph_settings(data.get());
 
       ImGui::Separator();
 
@@ -55,31 +1289,41 @@ void draw_app_system_window(std::shared_ptr<RefreshData> data) {
       ImGui::EndTabItem();
     }
 
-    if (ImGui::BeginTabItem("Fan")) {
+    if (ImGui::BeginTabItem("Power") &&
+        draw_app_tab_ready(data->ready.sensors)) {
+      draw_app_power_tab(data.get());
+      ImGui::EndTabItem();
+    }
+
+    if (ImGui::BeginTabItem("Fan") && draw_app_tab_ready(data->ready.sensors)) {
+      if (!data->fan.present)
+        ImGui::TextDisabled("No fan found");
 
-      ImGui::Checkbox("Animate", &data->graph.animated);
-      ImGui::SliderFloat("FPS", &data->graph.fps, 1.0f, 60.0f);
-      ImGui::SliderFloat("Scale", &data->graph.yscale, 0.0f, 100.0f);
+      draw_app_graph_settings(data.get());
 
       ImGui::Separator();
 
       char overlay[255];
-      sprintf(overlay, "Fan: %.2f RPM", data->fan.values.back());
+      sprintf(overlay, "Fan: %.0f RPM", data->fan.values.back());
+      // Raw RPM, far above the percents of the Y scale setting
       ImGui::PlotLines("Fan", data->fan.values.data(), data->fan.values.size(),
-                       0, overlay, 0, data->graph.yscale, ImVec2(0, 160.0f));
+                       0, overlay, 0.0f, FLT_MAX, ImVec2(0, 160.0f));
 
-      ImGui::TextColored(
-          ImVec4(1.0f, 0.0f, 0.0f, 1.0f),
+      const char* story =
           "Thrice upon a time, the fan wasn't there but now there is one ! "
-          "Lot of 🍪s !");
+          "Lot of 🍪s !";
+      fonts_request(story);
+      ImGui::TextColored(ImVec4(1.0f, 0.0f, 0.0f, 1.0f), "%s", story);
 
       ImGui::EndTabItem();
     }
 
-    if (ImGui::BeginTabItem("Thermal")) {
-      ImGui::Checkbox("Animate", &data->graph.animated);
-      ImGui::SliderFloat("FPS", &data->graph.fps, 1.0f, 60.0f);
-      ImGui::SliderFloat("Scale", &data->graph.yscale, 0.0f, 100.0f);
+    if (ImGui::BeginTabItem("Thermal") &&
+        draw_app_tab_ready(data->ready.sensors)) {
+      if (!data->thermal.present)
+        ImGui::TextDisabled("No thermal sensor found");
+
+      draw_app_graph_settings(data.get());
 
       ImGui::Separator();
 
@@ -89,6 +1333,20 @@ void draw_app_system_window(std::shared_ptr<RefreshData> data) {
                        data->thermal.values.size(), 0, overlay, 0,
                        data->graph.yscale, ImVec2(0, 160.0f));
 
+      ImGui::Separator();
+      draw_app_cpufreq(data.get());
+
+      ImGui::EndTabItem();
+    }
+
+    if (ImGui::BeginTabItem("Sensors") &&
+        draw_app_tab_ready(data->ready.sensors)) {
+      draw_app_sensors_tab(data.get());
+      ImGui::EndTabItem();
+    }
+
+    if (ImGui::BeginTabItem("Collectors")) {
+      draw_app_collectors_tab(data.get());
       ImGui::EndTabItem();
     }
 
@@ -99,7 +1357,8 @@ void draw_app_system_window(std::shared_ptr<RefreshData> data) {
 void draw_app_storage_window(std::shared_ptr<RefreshData> data_ptr) {
   RefreshData* data = data_ptr.get();
 
-  if (ImGui::CollapsingHeader("Memory", ImGuiTreeNodeFlags_DefaultOpen)) {
+  if (ImGui::CollapsingHeader("Memory", ImGuiTreeNodeFlags_DefaultOpen) &&
+      draw_app_ready(data->ready.memory)) {
     ImGui::TextWrapped("Physical (RAM):");
     ImGui::ProgressBar(data->memory.phys_percent, ImVec2(0.0f, 0.0f));
     ImGui::SameLine();
@@ -113,9 +1372,32 @@ void draw_app_storage_window(std::shared_ptr<RefreshData> data_ptr) {
     ImGui::TextWrapped("%s / %s",
                        human_readable(data->memory.virt_used).c_str(),
                        human_readable(data->memory.virt_total).c_str());
+
+    draw_app_vmstat(data);
+
+    const pressure_t& pressure = data->pressure[PRESSURE_MEMORY];
+    if (pressure.present) {
+      char overlay[64];
+      snprintf(overlay, 64, "Pressure: some %.2f%%, full %.2f%%",
+               pressure.some, pressure.full);
+      ImGui::PlotLines("##memory_pressure", pressure.some_values.data(),
+                       pressure.some_values.size(), 0, overlay, 0.0f, 100.0f,
+                       ImVec2(-FLT_MIN, 40.0f));
+    }
+
+    if (ImGui::TreeNode("Slab caches")) {
+      draw_app_slabs(data);
+      ImGui::TreePop();
+    }
+
+    if (ImGui::TreeNode("NUMA")) {
+      draw_app_numa(data);
+      ImGui::TreePop();
+    }
   }
 
-  if (ImGui::CollapsingHeader("Storage", ImGuiTreeNodeFlags_DefaultOpen)) {
+  if (ImGui::CollapsingHeader("Storage", ImGuiTreeNodeFlags_DefaultOpen) &&
+      draw_app_ready(data->ready.storages)) {
     for (const auto storage : data->storages) {
       ImGui::TextWrapped("HDD/SSD [%s]:", storage.device.c_str());
       ImGui::ProgressBar(storage.percent, ImVec2(0.0f, 0.0f));
@@ -125,7 +1407,10 @@ void draw_app_storage_window(std::shared_ptr<RefreshData> data_ptr) {
     }
   }
 
-  if (ImGui::CollapsingHeader("Processes")) {
+  bool details_shown = false;
+  bool profile_open = false;
+  if (ImGui::CollapsingHeader("Processes") &&
+      draw_app_ready(data->ready.processes)) {
     ImGui::InputText("##processes_filter", data->processes_filter,
                      IM_ARRAYSIZE(data->processes_filter), 0);
 
@@ -143,6 +1428,25 @@ void draw_app_storage_window(std::shared_ptr<RefreshData> data_ptr) {
       }
     }
 
+    ImGui::SameLine();
+    ImGui::BeginDisabled(data->processes_selection.size() != 1 ||
+                         data->profile.running);
+    if (ImGui::Button("Profile")) {
+      const pid_t pid = data->processes_selection.front();
+      std::string name;
+      for (const process_t& process : data->processes.processes) {
+        if (process.pid == pid)
+          name = process.name;
+      }
+      data->start_profile(pid, name);
+      profile_open = true;
+    }
+    ImGui::EndDisabled();
+    if (ImGui::IsItemHovered(ImGuiHoveredFlags_AllowWhenDisabled))
+      ImGui::SetTooltip("Samples the call stacks of the selected process "
+                        "for %.0f s",
+                        data->profile.seconds);
+
     std::vector<process_t> filtered_processes;
 
     for (auto process : data->processes.processes) {
@@ -150,16 +1454,70 @@ void draw_app_storage_window(std::shared_ptr<RefreshData> data_ptr) {
         filtered_processes.push_back(process);
     }
 
-    if (ImGui::BeginTable("##processes", 5,
-                          ImGuiTableFlags_Resizable |
-                              ImGuiTableFlags_Borders)) {
-      ImGui::TableSetupColumn("Pid");
-      ImGui::TableSetupColumn("Name");
-      ImGui::TableSetupColumn("State");
-      ImGui::TableSetupColumn("CPU %");
-      ImGui::TableSetupColumn("Mem %");
+    // Columns can be hidden and sorted from the headers
+    if (ImGui::BeginTable("##processes", PROCESS_COLUMNS,
+                          ImGuiTableFlags_Resizable | ImGuiTableFlags_Borders |
+                              ImGuiTableFlags_Hideable |
+                              ImGuiTableFlags_Sortable)) {
+      // The sort uses the user IDs, not the column indices
+      ImGui::TableSetupColumn("Pid", ImGuiTableColumnFlags_NoHide, 0.0f,
+                              PROCESS_COLUMN_PID);
+      ImGui::TableSetupColumn("Name", 0, 0.0f, PROCESS_COLUMN_NAME);
+      ImGui::TableSetupColumn("State", 0, 0.0f, PROCESS_COLUMN_STATE);
+      ImGui::TableSetupColumn("CPU %", 0, 0.0f, PROCESS_COLUMN_CPU);
+      ImGui::TableSetupColumn("Mem %", 0, 0.0f, PROCESS_COLUMN_MEM);
+      ImGui::TableSetupColumn("Last CPU", 0, 0.0f, PROCESS_COLUMN_LAST_CPU);
+      ImGui::TableSetupColumn("Minflt/s", 0, 0.0f, PROCESS_COLUMN_MINFLT);
+      ImGui::TableSetupColumn("Majflt/s", 0, 0.0f, PROCESS_COLUMN_MAJFLT);
+      ImGui::TableSetupColumn("IO wait/s", 0, 0.0f, PROCESS_COLUMN_BLKIO);
+      ImGui::TableSetupColumn("Read/s", ImGuiTableColumnFlags_DefaultHide,
+                              0.0f, PROCESS_COLUMN_READ);
+      ImGui::TableSetupColumn("Write/s", ImGuiTableColumnFlags_DefaultHide,
+                              0.0f, PROCESS_COLUMN_WRITE);
+      ImGui::TableSetupColumn("Run ms/s", ImGuiTableColumnFlags_DefaultHide,
+                              0.0f, PROCESS_COLUMN_RUN);
+      ImGui::TableSetupColumn("Wait ms/s", ImGuiTableColumnFlags_DefaultHide,
+                              0.0f, PROCESS_COLUMN_WAIT);
+      ImGui::TableSetupColumn("Slices/s", ImGuiTableColumnFlags_DefaultHide,
+                              0.0f, PROCESS_COLUMN_TIMESLICES);
+      ImGui::TableSetupColumn("Vol. cs/s", ImGuiTableColumnFlags_DefaultHide,
+                              0.0f, PROCESS_COLUMN_VOLUNTARY);
+      ImGui::TableSetupColumn("Invol. cs/s", ImGuiTableColumnFlags_DefaultHide,
+                              0.0f, PROCESS_COLUMN_NONVOLUNTARY);
+      ImGui::TableSetupColumn("Wait history", ImGuiTableColumnFlags_DefaultHide,
+                              0.0f, PROCESS_COLUMN_WAIT_HISTORY);
+      ImGui::TableSetupColumn("Invol. history",
+                              ImGuiTableColumnFlags_DefaultHide, 0.0f,
+                              PROCESS_COLUMN_NONVOLUNTARY_HISTORY);
       ImGui::TableHeadersRow();
 
+      // The optional files are only read while their columns are shown
+      const auto shown = [](int first, int last) {
+        for (int column = first; column <= last; column++) {
+          if (ImGui::TableGetColumnFlags(column) &
+              ImGuiTableColumnFlags_IsEnabled)
+            return true;
+        }
+        return false;
+      };
+      data->processes.io_shown =
+          shown(PROCESS_COLUMN_READ, PROCESS_COLUMN_WRITE);
+      data->processes.sched_shown =
+          shown(PROCESS_COLUMN_RUN, PROCESS_COLUMN_NONVOLUNTARY_HISTORY);
+
+      // Sorted every frame, the list changes with each refresh anyway
+      const ImGuiTableSortSpecs* specs = ImGui::TableGetSortSpecs();
+      if (specs && specs->SpecsCount > 0) {
+        const ImGuiTableColumnSortSpecs sort = specs->Specs[0];
+        std::stable_sort(
+            filtered_processes.begin(), filtered_processes.end(),
+            [&sort](const process_t& a, const process_t& b) {
+              if (sort.SortDirection == ImGuiSortDirection_Descending)
+                return process_less(b, a, sort.ColumnUserID);
+              return process_less(a, b, sort.ColumnUserID);
+            });
+      }
+
       for (const auto& process : filtered_processes) {
         const bool item_is_selected =
             std::find(data->processes_selection.begin(),
@@ -167,12 +1525,13 @@ void draw_app_storage_window(std::shared_ptr<RefreshData> data_ptr) {
                       process.pid) != data->processes_selection.end();
 
         ImGui::TableNextRow();
-        ImGui::TableSetColumnIndex(0);
+        ImGui::TableSetColumnIndex(PROCESS_COLUMN_PID);
 
         char pid_label[6];
         snprintf(pid_label, 6, "%d", process.pid);
         if (ImGui::Selectable(pid_label, item_is_selected,
-                              ImGuiSelectableFlags_SpanAllColumns)) {
+                              ImGuiSelectableFlags_SpanAllColumns |
+                                  ImGuiSelectableFlags_AllowItemOverlap)) {
           if (ImGui::GetIO().KeyCtrl) {
             if (item_is_selected)
               data->processes_selection.erase(
@@ -187,26 +1546,148 @@ void draw_app_storage_window(std::shared_ptr<RefreshData> data_ptr) {
           }
         }
 
-        ImGui::TableSetColumnIndex(1);
+        ImGui::TableSetColumnIndex(PROCESS_COLUMN_NAME);
+        const auto expanded_it =
+            std::find(data->processes_expanded.begin(),
+                      data->processes_expanded.end(), process.pid);
+        const bool expanded = expanded_it != data->processes_expanded.end();
+        if (process.pstat1.num_threads > 1) {
+          // The threads are collected from the next refresh on
+          ImGui::PushID(process.pid);
+          if (ImGui::ArrowButton("##threads",
+                                 expanded ? ImGuiDir_Down : ImGuiDir_Right)) {
+            if (expanded)
+              data->processes_expanded.erase(expanded_it);
+            else
+              data->processes_expanded.push_back(process.pid);
+          }
+          ImGui::PopID();
+          ImGui::SameLine();
+        }
+
+        fonts_request(process.name.c_str());
         if (process.pid == data->pid)
           ImGui::TextColored(ImVec4(1.0f, 1.0f, 0.0f, 1.0f),
                              process.name.c_str());
         else
           ImGui::Text("%s", process.name.c_str());
 
-        ImGui::TableSetColumnIndex(2);
+        ImGui::TableSetColumnIndex(PROCESS_COLUMN_STATE);
         ImGui::Text("%c", process.state);
 
-        ImGui::TableSetColumnIndex(3);
+        ImGui::TableSetColumnIndex(PROCESS_COLUMN_CPU);
         ImGui::Text("%.1f%%", process.cpu);
 
-        ImGui::TableSetColumnIndex(4);
+        ImGui::TableSetColumnIndex(PROCESS_COLUMN_MEM);
         ImGui::Text("%.1f%%", process.mem);
+
+        ImGui::TableSetColumnIndex(PROCESS_COLUMN_LAST_CPU);
+        ImGui::Text("%d", process.pstat1.processor);
+
+        ImGui::TableSetColumnIndex(PROCESS_COLUMN_MINFLT);
+        ImGui::Text("%.0f", process.minflt_rate);
+
+        ImGui::TableSetColumnIndex(PROCESS_COLUMN_MAJFLT);
+        ImGui::Text("%.0f", process.majflt_rate);
+
+        ImGui::TableSetColumnIndex(PROCESS_COLUMN_BLKIO);
+        ImGui::Text("%.0f", process.blkio_rate);
+
+        if (process.io) {
+          ImGui::TableSetColumnIndex(PROCESS_COLUMN_READ);
+          ImGui::Text("%s", human_readable(process.read_rate).c_str());
+
+          ImGui::TableSetColumnIndex(PROCESS_COLUMN_WRITE);
+          ImGui::Text("%s", human_readable(process.write_rate).c_str());
+        }
+
+        if (process.sched) {
+          const float rates[] = {
+              process.run_rate,
+              process.wait_rate,
+              process.timeslices_rate,
+              process.voluntary_rate,
+              process.nonvoluntary_rate,
+          };
+          for (int i = 0; i < 5; i++) {
+            ImGui::TableSetColumnIndex(PROCESS_COLUMN_RUN + i);
+            ImGui::Text("%.1f", rates[i]);
+          }
+
+          const auto history_it = data->processes.history.find(process.pid);
+          if (history_it != data->processes.history.end()) {
+            const process_history_t& history = history_it->second;
+            const ImVec2 size(-FLT_MIN, ImGui::GetTextLineHeight());
+
+            ImGui::PushID(process.pid);
+            ImGui::TableSetColumnIndex(PROCESS_COLUMN_WAIT_HISTORY);
+            ImGui::PlotLines("##wait", history.wait.data(),
+                             history.wait.size(), 0, nullptr, 0.0f, FLT_MAX,
+                             size);
+            ImGui::TableSetColumnIndex(PROCESS_COLUMN_NONVOLUNTARY_HISTORY);
+            ImGui::PlotLines("##nonvoluntary", history.nonvoluntary.data(),
+                             history.nonvoluntary.size(), 0, nullptr, 0.0f,
+                             FLT_MAX, size);
+            ImGui::PopID();
+          }
+        }
+
+        if (!expanded)
+          continue;
+
+        const auto threads_it = data->processes.threads.find(process.pid);
+        if (threads_it == data->processes.threads.end()) {
+          ImGui::TableNextRow();
+          ImGui::TableSetColumnIndex(1);
+          ImGui::Indent();
+          ImGui::TextDisabled("Loading...");
+          ImGui::Unindent();
+          continue;
+        }
+
+        for (const thread_t& thread : threads_it->second) {
+          ImGui::TableNextRow();
+          ImGui::TableSetColumnIndex(0);
+          ImGui::TextDisabled("%d", thread.tid);
+
+          ImGui::TableSetColumnIndex(1);
+          ImGui::Indent();
+          fonts_request(thread.name.c_str());
+          ImGui::Text("%s", thread.name.c_str());
+          ImGui::Unindent();
+
+          ImGui::TableSetColumnIndex(2);
+          ImGui::Text("%c", thread.state);
+
+          ImGui::TableSetColumnIndex(3);
+          ImGui::Text("%.1f%%", thread.cpu);
+
+          ImGui::TableSetColumnIndex(5);
+          ImGui::Text("%d", thread.processor);
+        }
       }
 
       ImGui::EndTable();
     }
+
+    details_shown = ImGui::TreeNode("Memory detail");
+    if (details_shown) {
+      draw_app_memory_details(data);
+      ImGui::TreePop();
+    }
+
+    if (profile_open)
+      ImGui::SetNextItemOpen(true);
+    if (ImGui::TreeNode("Profile")) {
+      draw_app_profile(data);
+      ImGui::TreePop();
+    }
   }
+  data->processes.details_shown = details_shown;
+
+  if (ImGui::CollapsingHeader("Cgroups") &&
+      draw_app_ready(data->ready.cgroups))
+    draw_app_cgroups(data);
 
   if (ImGui::BeginPopupModal("Information")) {
     ImGui::Text("There is actually no selected processes.");
@@ -216,7 +1697,235 @@ void draw_app_storage_window(std::shared_ptr<RefreshData> data_ptr) {
   }
 }
 
+// Drops and squeezes mean the softirq cannot keep up with the NICs,
+// net.core.netdev_max_backlog and netdev_budget are the usual knobs
+static void draw_app_softnet(RefreshData* data) {
+  if (data->network.softnet.empty()) {
+    ImGui::TextDisabled("/proc/net/softnet_stat unavailable");
+    return;
+  }
+
+  if (!ImGui::BeginTable("##softnet", 6, ImGuiTableFlags_Borders))
+    return;
+
+  ImGui::TableSetupColumn("Core");
+  ImGui::TableSetupColumn("Processed/s");
+  ImGui::TableSetupColumn("Dropped/s");
+  ImGui::TableSetupColumn("Time squeezes/s");
+  ImGui::TableSetupColumn("RPS received/s");
+  ImGui::TableSetupColumn("Flow limit/s");
+  ImGui::TableHeadersRow();
+
+  const ImVec4 alarm(1.0f, 0.3f, 0.3f, 1.0f);
+  for (const softnet_core_t& core : data->network.softnet) {
+    ImGui::TableNextRow();
+    ImGui::TableSetColumnIndex(0);
+    ImGui::Text("cpu%d", core.cpu);
+    ImGui::TableSetColumnIndex(1);
+    ImGui::Text("%.0f", core.processed);
+
+    ImGui::TableSetColumnIndex(2);
+    if (core.dropped > 0.0f)
+      ImGui::TextColored(alarm, "%.0f", core.dropped);
+    else
+      ImGui::Text("0");
+    if (ImGui::IsItemHovered())
+      ImGui::SetTooltip("%lu since boot", core.total_dropped);
+
+    ImGui::TableSetColumnIndex(3);
+    if (core.time_squeeze > 0.0f)
+      ImGui::TextColored(ImVec4(1.0f, 0.6f, 0.0f, 1.0f), "%.0f",
+                         core.time_squeeze);
+    else
+      ImGui::Text("0");
+    if (ImGui::IsItemHovered())
+      ImGui::SetTooltip("%lu since boot", core.total_time_squeeze);
+
+    ImGui::TableSetColumnIndex(4);
+    ImGui::Text("%.0f", core.received_rps);
+    ImGui::TableSetColumnIndex(5);
+    ImGui::Text("%.0f", core.flow_limit);
+  }
+
+  ImGui::EndTable();
+}
+
+static void draw_app_net_errors(RefreshData* data) {
+  if (!ImGui::BeginTable("##net_errors", 3, ImGuiTableFlags_SizingStretchSame))
+    return;
+
+  for (int i = 0; i < NET_COUNTERS; i++) {
+    if (!data->network.counters_present[i])
+      continue;
+
+    ImGui::TableNextColumn();
+    const float current = data->network.counters[i];
+    const std::array<float, 60>& values = data->network.counter_values[i];
+
+    char overlay[64];
+    snprintf(overlay, 64, "%s: %.0f/s", net_counter_name((net_counter_t)i),
+             current);
+    if (current > 0.0f)
+      ImGui::PushStyleColor(ImGuiCol_PlotLines,
+                            ImVec4(1.0f, 0.3f, 0.3f, 1.0f));
+    ImGui::PushID(i);
+    ImGui::PlotLines("##net_error", values.data(), values.size(), 0, overlay,
+                     0.0f, FLT_MAX, ImVec2(-FLT_MIN, 30.0f));
+    ImGui::PopID();
+    if (current > 0.0f)
+      ImGui::PopStyleColor();
+  }
+
+  ImGui::EndTable();
+}
+
+// The kernel filters the dump, only the visible rows are formatted
+static void draw_app_connections(RefreshData* data) {
+  static const struct {
+    const char* label;
+    uint32_t states;
+  } presets[] = {
+      {"All states", ~0u},
+      {"Established", 1u << 1},
+      {"Listening", 1u << 10},
+      {"Time wait", 1u << 6},
+      {"Not listening", ~(1u << 10)},
+  };
+
+  socket_filter_t& filter = data->sockets.filter;
+  bool changed = false;
+  changed |= ImGui::Checkbox("TCP", &filter.tcp);
+  ImGui::SameLine();
+  changed |= ImGui::Checkbox("UDP", &filter.udp);
+  ImGui::SameLine();
+  changed |= ImGui::Checkbox("Unix", &filter.unix_);
+
+  int preset = 0;
+  for (int i = 0; i < IM_ARRAYSIZE(presets); i++)
+    if (presets[i].states == filter.states)
+      preset = i;
+  ImGui::SameLine();
+  ImGui::SetNextItemWidth(ImGui::GetFontSize() * 9);
+  if (ImGui::BeginCombo("##states", presets[preset].label)) {
+    for (int i = 0; i < IM_ARRAYSIZE(presets); i++) {
+      if (ImGui::Selectable(presets[i].label, i == preset)) {
+        filter.states = presets[i].states;
+        changed = true;
+      }
+    }
+    ImGui::EndCombo();
+  }
+
+  int port = filter.port;
+  ImGui::SameLine();
+  ImGui::SetNextItemWidth(ImGui::GetFontSize() * 6);
+  if (ImGui::InputInt("Port", &port, 0, 0)) {
+    filter.port = std::max(0, std::min(65535, port));
+    changed = true;
+  }
+
+  ImGui::SameLine();
+  if (data->sockets.error)
+    ImGui::TextColored(ImVec4(1.0f, 0.3f, 0.3f, 1.0f), "%s",
+                       strerror(data->sockets.error));
+  else
+    ImGui::TextDisabled("%zu sockets in %.1f ms", data->sockets.list.size(),
+                        data->sockets.duration);
+
+  if (ImGui::BeginTable("##sockets", SOCKET_COLUMNS,
+                        ImGuiTableFlags_Resizable | ImGuiTableFlags_Borders |
+                            ImGuiTableFlags_Sortable |
+                            ImGuiTableFlags_Hideable |
+                            ImGuiTableFlags_ScrollY,
+                        ImVec2(0.0f,
+                               ImGui::GetTextLineHeightWithSpacing() * 16))) {
+    ImGui::TableSetupScrollFreeze(0, 1);
+    ImGui::TableSetupColumn("Proto");
+    ImGui::TableSetupColumn("State");
+    ImGui::TableSetupColumn("Local", ImGuiTableColumnFlags_DefaultSort);
+    ImGui::TableSetupColumn("Remote");
+    ImGui::TableSetupColumn("Recv-Q",
+                            ImGuiTableColumnFlags_PreferSortDescending);
+    ImGui::TableSetupColumn("Send-Q",
+                            ImGuiTableColumnFlags_PreferSortDescending);
+    ImGui::TableSetupColumn("RTT", ImGuiTableColumnFlags_PreferSortDescending);
+    ImGui::TableSetupColumn("Retrans",
+                            ImGuiTableColumnFlags_PreferSortDescending);
+    ImGui::TableSetupColumn("Acked",
+                            ImGuiTableColumnFlags_PreferSortDescending);
+    ImGui::TableSetupColumn("Received",
+                            ImGuiTableColumnFlags_PreferSortDescending);
+    ImGui::TableSetupColumn("UID");
+    ImGui::TableHeadersRow();
+
+    // Sorting 200k rows is left to the collector
+    ImGuiTableSortSpecs* specs = ImGui::TableGetSortSpecs();
+    if (specs && specs->SpecsDirty && specs->SpecsCount > 0) {
+      data->sockets.sort_column = specs->Specs[0].ColumnIndex;
+      data->sockets.sort_descending =
+          specs->Specs[0].SortDirection == ImGuiSortDirection_Descending;
+      specs->SpecsDirty = false;
+      changed = true;
+    }
+
+    const std::vector<socket_t>& list = data->sockets.list;
+    ImGuiListClipper clipper;
+    clipper.Begin(list.size());
+    while (clipper.Step()) {
+      for (int row = clipper.DisplayStart; row < clipper.DisplayEnd; row++) {
+        const socket_t& socket = list[row];
+        ImGui::TableNextRow();
+
+        ImGui::TableSetColumnIndex(SOCKET_COLUMN_PROTOCOL);
+        if (socket.protocol == SOCKET_UNIX)
+          ImGui::Text("unix");
+        else
+          ImGui::Text("%s%s", socket.protocol == SOCKET_TCP ? "tcp" : "udp",
+                      socket.family == AF_INET6 ? "6" : "");
+        ImGui::TableSetColumnIndex(SOCKET_COLUMN_STATE);
+        ImGui::Text("%s", socket_state_name(socket.state));
+        ImGui::TableSetColumnIndex(SOCKET_COLUMN_LOCAL);
+        ImGui::Text("%s", socket_address(socket, false).c_str());
+        ImGui::TableSetColumnIndex(SOCKET_COLUMN_REMOTE);
+        ImGui::Text("%s", socket_address(socket, true).c_str());
+        ImGui::TableSetColumnIndex(SOCKET_COLUMN_RX_QUEUE);
+        ImGui::Text("%u", socket.rx_queue);
+        ImGui::TableSetColumnIndex(SOCKET_COLUMN_TX_QUEUE);
+        ImGui::Text("%u", socket.tx_queue);
+
+        if (socket.info) {
+          ImGui::TableSetColumnIndex(SOCKET_COLUMN_RTT);
+          ImGui::Text("%.1f ms", socket.rtt / 1000.0f);
+          if (ImGui::IsItemHovered())
+            ImGui::SetTooltip("Variance %.1f ms", socket.rttvar / 1000.0f);
+          ImGui::TableSetColumnIndex(SOCKET_COLUMN_RETRANSMITS);
+          if (socket.retransmits > 0)
+            ImGui::TextColored(ImVec4(1.0f, 0.6f, 0.0f, 1.0f), "%u",
+                               socket.retransmits);
+          else
+            ImGui::Text("0");
+          ImGui::TableSetColumnIndex(SOCKET_COLUMN_ACKED);
+          ImGui::Text("%s", human_readable(socket.bytes_acked).c_str());
+          ImGui::TableSetColumnIndex(SOCKET_COLUMN_RECEIVED);
+          ImGui::Text("%s", human_readable(socket.bytes_received).c_str());
+        }
+
+        ImGui::TableSetColumnIndex(SOCKET_COLUMN_UID);
+        ImGui::Text("%u", socket.uid);
+      }
+    }
+
+    ImGui::EndTable();
+  }
+
+  if (changed && data->collectors.sockets >= 0)
+    data->scheduler->trigger(data->collectors.sockets);
+}
+
 void draw_app_network_window(std::shared_ptr<RefreshData> data) {
+  if (!draw_app_ready(data->ready.network))
+    return;
+
   if (ImGui::CollapsingHeader("Interfaces", ImGuiTreeNodeFlags_None)) {
     if (ImGui::BeginTable("##nics", 4, ImGuiTableFlags_Borders)) {
       ImGui::TableSetupColumn("Interface name");
@@ -339,6 +2048,28 @@ void draw_app_network_window(std::shared_ptr<RefreshData> data) {
       ImGui::TreePop();
     }
   }
+
+  if (ImGui::CollapsingHeader("Backlog and protocol errors",
+                              ImGuiTreeNodeFlags_None)) {
+    if (ImGui::TreeNode("Per core backlog")) {
+      draw_app_softnet(data.get());
+      ImGui::TreePop();
+    }
+
+    if (ImGui::TreeNode("Protocol errors")) {
+      draw_app_net_errors(data.get());
+      ImGui::TreePop();
+    }
+  }
+
+  // The sockets are only dumped while listed
+  const bool shown =
+      ImGui::CollapsingHeader("Connections", ImGuiTreeNodeFlags_None);
+  if (shown)
+    draw_app_connections(data.get());
+  if (shown && !data->sockets.shown && data->collectors.sockets >= 0)
+    data->scheduler->trigger(data->collectors.sockets);
+  data->sockets.shown = shown;
 }
 
 static void draw_app_window(std::shared_ptr<RefreshData> data, const char* n,
@@ -360,3 +2091,8 @@ void draw_app(std::shared_ptr<RefreshData> data, ImVec2& display) {
   draw_app_window(data, "Network", ImVec2(display.x - 20, (display.y / 2) - 60),
                   ImVec2(10, (display.y / 2) + 50), draw_app_network_window);
 }
+
+void draw_app_shutdown() {
+  cpu_heatmap.destroy();
+  irq_heatmap.destroy();
+}
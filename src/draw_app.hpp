@@ -1,6 +1,8 @@
 #ifndef __IMPRINT_HPP__
 #define __IMPRINT_HPP__
 
+#include "fonts.hpp"
+#include "heatmap.hpp"
 #include "refresh_data.hpp"
 #include "utilities.hpp"
 #include <imgui.h>
@@ -9,5 +11,6 @@ void draw_app_system_window(std::shared_ptr<RefreshData> data);
 void draw_app_storage_window(std::shared_ptr<RefreshData> data);
 void draw_app_network_window(std::shared_ptr<RefreshData> data);
 void draw_app(std::shared_ptr<RefreshData> data, ImVec2& display);
+void draw_app_shutdown();
 
 #endif
\ No newline at end of file
@@ -0,0 +1,94 @@
+#include "fonts.hpp"
+
+#include "imgui_freetype.h"
+#include "imgui_internal.h"
+
+#include <string.h>
+
+#include "seguiemj.font.hpp"
+
+static const float FONT_SIZE = 13.0f;
+
+static ImFontGlyphRangesBuilder requested;
+static ImVector<ImWchar> ranges;
+static bool dirty = false;
+
+static void* emoji_ttf = nullptr;
+static int emoji_ttf_size = 0;
+
+static void fonts_add(ImFontAtlas* atlas) {
+  atlas->AddFontDefault();
+
+  if (ranges.Size <= 1)
+    return;
+
+  ImFontConfig cfg;
+  cfg.OversampleH = cfg.OversampleV = 1;
+  cfg.MergeMode = true;
+  cfg.FontBuilderFlags |= ImGuiFreeTypeBuilderFlags_LoadColor;
+
+  if (emoji_ttf == nullptr) {
+    atlas->AddFontFromMemoryCompressedBase85TTF(
+        SegoeUIEmoji_compressed_data_base85, FONT_SIZE, &cfg, ranges.Data);
+
+    // Take ownership of the decompressed data so that the next rebuilds do
+    // not have to decompress it again.
+    ImFontConfig& added = atlas->ConfigData.back();
+    added.FontDataOwnedByAtlas = false;
+    emoji_ttf = added.FontData;
+    emoji_ttf_size = added.FontDataSize;
+  } else {
+    cfg.FontDataOwnedByAtlas = false;
+    atlas->AddFontFromMemoryTTF(emoji_ttf, emoji_ttf_size, FONT_SIZE, &cfg,
+                                ranges.Data);
+  }
+}
+
+void fonts_setup(ImFontAtlas* atlas) {
+  requested.Clear();
+  ranges.clear();
+  ranges.push_back(0);
+  fonts_add(atlas);
+}
+
+void fonts_request(const char* text, const char* text_end) {
+  if (text_end == nullptr)
+    text_end = text + strlen(text);
+
+  while (text < text_end) {
+    if ((unsigned char)*text < 0x80) {
+      text++;
+      continue;
+    }
+
+    unsigned int c;
+    text += ImTextCharFromUtf8(&c, text, text_end);
+
+    // Latin-1 is covered by the default font
+    if (c <= 0xFF || requested.GetBit(c))
+      continue;
+
+    requested.AddChar((ImWchar)c);
+    dirty = true;
+  }
+}
+
+bool fonts_rebuild(ImFontAtlas* atlas) {
+  if (!dirty)
+    return false;
+
+  dirty = false;
+  ranges.clear();
+  requested.BuildRanges(&ranges);
+
+  atlas->Clear();
+  fonts_add(atlas);
+  return true;
+}
+
+void fonts_shutdown() {
+  if (emoji_ttf != nullptr)
+    IM_FREE(emoji_ttf);
+  emoji_ttf = nullptr;
+  emoji_ttf_size = 0;
+}
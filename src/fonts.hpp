@@ -0,0 +1,15 @@
+#ifndef __FONTS_HPP__
+#define __FONTS_HPP__
+
+#include <imgui.h>
+
+// The embedded emoji font is merged into the default font lazily: the glyphs
+// are registered with fonts_request() while drawing and rasterized into the
+// atlas before the next frame. The compressed TTF is only decompressed the
+// first time a glyph outside of the default font is requested.
+void fonts_setup(ImFontAtlas* atlas);
+void fonts_request(const char* text, const char* text_end = nullptr);
+bool fonts_rebuild(ImFontAtlas* atlas);
+void fonts_shutdown();
+
+#endif
@@ -0,0 +1,116 @@
+#include "heatmap.hpp"
+
+#include <algorithm>
+#include <math.h>
+
+static uint32_t heatmap_color(float v) {
+  if (v < 0.0f)
+    v = 0.0f;
+  if (v > 1.0f)
+    v = 1.0f;
+
+  // From blue (idle) to red (busy)
+  float r, g, b;
+  ImGui::ColorConvertHSVtoRGB(0.66f * (1.0f - v), 0.9f, 0.25f + 0.75f * v, r,
+                              g, b);
+  return IM_COL32((int)(r * 255), (int)(g * 255), (int)(b * 255), 255);
+}
+
+Heatmap::Heatmap(int columns, bool logarithmic)
+    : generation(0), m_texture(0), m_logarithmic(logarithmic),
+      m_columns(columns), m_rows(0), m_head(0) {}
+
+void Heatmap::resize(int columns) {
+  if (columns == m_columns)
+    return;
+
+  m_columns = columns;
+  m_rows = 0;
+}
+
+void Heatmap::allocate(int rows) {
+  GLint last_texture;
+  glGetIntegerv(GL_TEXTURE_BINDING_2D, &last_texture);
+
+  if (m_texture == 0)
+    glGenTextures(1, &m_texture);
+
+  std::vector<uint32_t> blank(m_columns * rows, IM_COL32(0, 0, 0, 255));
+
+  glBindTexture(GL_TEXTURE_2D, m_texture);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, m_columns, rows, 0, GL_RGBA,
+               GL_UNSIGNED_BYTE, blank.data());
+  glBindTexture(GL_TEXTURE_2D, last_texture);
+
+  m_rows = rows;
+  m_head = 0;
+  m_pixels.assign(rows, 0);
+  m_values.assign(m_columns * rows, 0.0f);
+}
+
+void Heatmap::push_column(const float* values, int rows, float scale) {
+  if (rows <= 0 || m_columns <= 0)
+    return;
+
+  if (rows != m_rows || m_texture == 0)
+    allocate(rows);
+
+  for (int row = 0; row < rows; row++) {
+    m_values[m_head * rows + row] = values[row];
+    if (scale <= 0.0f)
+      m_pixels[row] = heatmap_color(0.0f);
+    else if (m_logarithmic)
+      m_pixels[row] =
+          heatmap_color(logf(1.0f + values[row]) / logf(1.0f + scale));
+    else
+      m_pixels[row] = heatmap_color(values[row] / scale);
+  }
+
+  GLint last_texture;
+  glGetIntegerv(GL_TEXTURE_BINDING_2D, &last_texture);
+  glBindTexture(GL_TEXTURE_2D, m_texture);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+  glTexSubImage2D(GL_TEXTURE_2D, 0, m_head, 0, 1, rows, GL_RGBA,
+                  GL_UNSIGNED_BYTE, m_pixels.data());
+  glBindTexture(GL_TEXTURE_2D, last_texture);
+
+  m_head = (m_head + 1) % m_columns;
+}
+
+void Heatmap::draw(const char* id, ImVec2 size, const char* tooltip_fmt) {
+  const ImVec2 pos = ImGui::GetCursorScreenPos();
+  ImGui::InvisibleButton(id, size);
+
+  if (m_texture == 0 || m_rows == 0 || size.x <= 0.0f || size.y <= 0.0f)
+    return;
+
+  // The oldest column is the one about to be overwritten
+  const float u0 = (float)m_head / (float)m_columns;
+  ImGui::GetWindowDrawList()->AddImage(
+      (ImTextureID)(intptr_t)m_texture, pos,
+      ImVec2(pos.x + size.x, pos.y + size.y), ImVec2(u0, 0.0f),
+      ImVec2(u0 + 1.0f, 1.0f));
+
+  if (tooltip_fmt && ImGui::IsItemHovered()) {
+    const ImVec2 mouse = ImGui::GetIO().MousePos;
+    int column = (int)((mouse.x - pos.x) / size.x * m_columns);
+    int row = (int)((mouse.y - pos.y) / size.y * m_rows);
+    column = std::max(0, std::min(column, m_columns - 1));
+    row = std::max(0, std::min(row, m_rows - 1));
+
+    const int index = (m_head + column) % m_columns;
+    ImGui::SetTooltip(tooltip_fmt, row, m_values[index * m_rows + row]);
+  }
+}
+
+void Heatmap::destroy() {
+  if (m_texture != 0)
+    glDeleteTextures(1, &m_texture);
+  m_texture = 0;
+  m_rows = 0;
+}
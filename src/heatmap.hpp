@@ -0,0 +1,44 @@
+#ifndef __HEATMAP_HPP__
+#define __HEATMAP_HPP__
+
+#include <GLFW/glfw3.h>
+#include <imgui.h>
+
+#include <stdint.h>
+#include <vector>
+
+// Rows on Y, time on X. The texture is used as a ring buffer: every sample
+// uploads a single column with glTexSubImage2D and the quad is drawn with a
+// shifted U coordinate, so the cost per frame does not depend on the number
+// of rows nor on the length of the history. Pushing as many columns as the
+// width between draws turns it into a plain matrix, first column on the left.
+class Heatmap {
+public:
+  Heatmap(int columns, bool logarithmic = false);
+
+  // Clears the texture when the width changes
+  void resize(int columns);
+
+  void push_column(const float* values, int rows, float scale);
+  // No tooltip when tooltip_fmt is null
+  void draw(const char* id, ImVec2 size, const char* tooltip_fmt);
+
+  // Must be called while the GL context is still current
+  void destroy();
+
+  uint64_t generation;
+
+private:
+  void allocate(int rows);
+
+  GLuint m_texture;
+  bool m_logarithmic;
+  int m_columns;
+  int m_rows;
+  int m_head;
+
+  std::vector<uint32_t> m_pixels;
+  std::vector<float> m_values;
+};
+
+#endif
@@ -0,0 +1,212 @@
+#include "interrupts.hpp"
+
+#include <algorithm>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <unordered_map>
+
+InterruptCounters::InterruptCounters(const std::string& path)
+    : m_cpus(0), m_cpus_changed(false), m_parsed(0), m_size(0) {
+  m_fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+}
+
+InterruptCounters::~InterruptCounters() {
+  if (m_fd >= 0)
+    close(m_fd);
+}
+
+bool InterruptCounters::valid() const { return m_fd >= 0; }
+
+int InterruptCounters::cpus() const { return m_cpus; }
+
+const std::vector<int>& InterruptCounters::cpu_ids() const {
+  return m_cpu_ids;
+}
+
+size_t InterruptCounters::parsed() const { return m_parsed; }
+
+// Reads the whole file, growing the buffer as needed, and splits the rows
+bool InterruptCounters::read() {
+  if (m_fd < 0)
+    return false;
+
+  if (m_buffer.empty())
+    m_buffer.resize(16384);
+
+  m_size = 0;
+  for (;;) {
+    if (m_size == m_buffer.size())
+      m_buffer.resize(m_buffer.size() * 2);
+
+    const ssize_t n =
+        pread(m_fd, m_buffer.data() + m_size, m_buffer.size() - m_size, m_size);
+    if (n < 0)
+      return false;
+    if (n == 0)
+      break;
+    m_size += n;
+  }
+
+  const char* data = m_buffer.data();
+  const char* end = data + m_size;
+
+  // The header holds one "CPUn" per online CPU, with gaps for the offline
+  // ones. The numbers are updated in place as they rarely change.
+  const char* line_end = (const char*)memchr(data, '\n', m_size);
+  if (!line_end)
+    return false;
+  size_t cpus = 0;
+  m_cpus_changed = false;
+  for (const char* p = data; p + 3 <= line_end; p++) {
+    if (p[0] != 'C' || p[1] != 'P' || p[2] != 'U')
+      continue;
+
+    int id = 0;
+    for (p += 3; p < line_end && *p >= '0' && *p <= '9'; p++)
+      id = id * 10 + (*p - '0');
+    if (cpus == m_cpu_ids.size()) {
+      m_cpu_ids.push_back(id);
+      m_cpus_changed = true;
+    } else if (m_cpu_ids[cpus] != id) {
+      m_cpu_ids[cpus] = id;
+      m_cpus_changed = true;
+    }
+    cpus++;
+  }
+  if (cpus != m_cpu_ids.size()) {
+    m_cpu_ids.resize(cpus);
+    m_cpus_changed = true;
+  }
+  m_cpus = cpus;
+
+  m_rows.clear();
+  for (const char* line = line_end + 1; line < end; line = line_end + 1) {
+    line_end = (const char*)memchr(line, '\n', end - line);
+    if (!line_end)
+      line_end = end;
+
+    const char* name = line;
+    while (name < line_end && *name == ' ')
+      name++;
+    const char* colon = (const char*)memchr(name, ':', line_end - name);
+    if (!colon)
+      continue;
+
+    m_rows.push_back(row_t{(size_t)(line - data), (size_t)(line_end - line),
+                           (size_t)(name - data), (size_t)(colon - name)});
+  }
+
+  return true;
+}
+
+// Counters up to the number of CPUs, some rows such as ERR only have one,
+// then the description of the interrupt
+void InterruptCounters::parse_row(const row_t& row,
+                                  irq_source_t& source) const {
+  const char* p = m_buffer.data() + row.name_offset + row.name_length + 1;
+  const char* end = m_buffer.data() + row.offset + row.length;
+
+  source.counts.resize(m_cpus);
+  int cpu = 0;
+  while (cpu < m_cpus) {
+    while (p < end && *p == ' ')
+      p++;
+    if (p == end || *p < '0' || *p > '9')
+      break;
+
+    uint64_t value = 0;
+    for (; p < end && *p >= '0' && *p <= '9'; p++)
+      value = value * 10 + (*p - '0');
+    source.counts[cpu++] = value;
+  }
+  std::fill(source.counts.begin() + cpu, source.counts.end(), 0);
+
+  while (p < end && *p == ' ')
+    p++;
+  if (source.description.size() != (size_t)(end - p) ||
+      memcmp(source.description.data(), p, end - p) != 0)
+    source.description.assign(p, end - p);
+}
+
+bool InterruptCounters::update(std::vector<irq_source_t>& sources,
+                               float seconds) {
+  if (!read())
+    return false;
+
+  // Rows are matched by position while the names and the CPUs stay the same
+  bool reshaped = m_rows.size() != sources.size() || m_cpus_changed;
+  for (size_t i = 0; i < m_rows.size() && !reshaped; i++) {
+    const row_t& row = m_rows[i];
+    reshaped = sources[i].name.size() != row.name_length ||
+               memcmp(sources[i].name.data(),
+                      m_buffer.data() + row.name_offset, row.name_length) != 0;
+  }
+
+  m_parsed = 0;
+  if (reshaped) {
+    // Interrupts come and go with the devices, keep the history of the
+    // remaining ones
+    std::unordered_map<std::string, irq_source_t> known;
+    for (irq_source_t& source : sources)
+      known.emplace(source.name, std::move(source));
+
+    std::vector<irq_source_t> next(m_rows.size());
+    for (size_t i = 0; i < m_rows.size(); i++) {
+      const row_t& row = m_rows[i];
+      irq_source_t& source = next[i];
+      source.name.assign(m_buffer.data() + row.name_offset, row.name_length);
+
+      const auto it = known.find(source.name);
+      if (it != known.end())
+        source.values = it->second.values;
+      else
+        source.values.fill(0.0f);
+
+      parse_row(row, source);
+      source.rates.assign(m_cpus, 0.0f);
+      source.total = 0.0f;
+      m_parsed++;
+    }
+    sources = std::move(next);
+  } else {
+    for (size_t i = 0; i < m_rows.size(); i++) {
+      const row_t& row = m_rows[i];
+      irq_source_t& source = sources[i];
+
+      const row_t* last =
+          i < m_previous_rows.size() ? &m_previous_rows[i] : nullptr;
+      const bool unchanged =
+          last && last->length == row.length &&
+          memcmp(m_previous.data() + last->offset,
+                 m_buffer.data() + row.offset, row.length) == 0;
+
+      if (unchanged) {
+        if (source.total != 0.0f) {
+          std::fill(source.rates.begin(), source.rates.end(), 0.0f);
+          source.total = 0.0f;
+        }
+      } else {
+        m_last.assign(source.counts.begin(), source.counts.end());
+        parse_row(row, source);
+        m_parsed++;
+
+        source.total = 0.0f;
+        for (int cpu = 0; cpu < m_cpus; cpu++) {
+          const uint64_t count = source.counts[cpu];
+          const uint64_t delta = count >= m_last[cpu] ? count - m_last[cpu] : 0;
+          source.rates[cpu] = seconds > 0.0f ? delta / seconds : 0.0f;
+          source.total += source.rates[cpu];
+        }
+      }
+
+      std::rotate(source.values.begin(), source.values.begin() + 1,
+                  source.values.end());
+      source.values.back() = source.total;
+    }
+  }
+
+  std::swap(m_buffer, m_previous);
+  std::swap(m_rows, m_previous_rows);
+  return true;
+}
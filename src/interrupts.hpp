@@ -0,0 +1,62 @@
+#ifndef __INTERRUPTS_HPP__
+#define __INTERRUPTS_HPP__
+
+#include <array>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+// A row of /proc/interrupts or /proc/softirqs
+struct irq_source_t {
+  std::string name;        // "24", "NMI", "TIMER"...
+  std::string description; // chip, trigger and devices, interrupts only
+  std::vector<uint64_t> counts; // per CPU, cumulated
+  std::vector<float> rates;     // per CPU, per second
+  float total;                  // per second
+  std::array<float, 60> values; // total history
+};
+
+// The file is read into a reused buffer and parsed in place. Rows whose text
+// did not change since the previous read are not parsed again, their rates
+// are simply zero, and the names are only allocated when the rows change.
+class InterruptCounters {
+public:
+  InterruptCounters(const std::string& path);
+  ~InterruptCounters();
+
+  bool valid() const;
+  int cpus() const;
+  // Numbers of the CPUs of the columns, the offline ones are not listed
+  const std::vector<int>& cpu_ids() const;
+  // Rates over the seconds elapsed since the previous update. Returns false
+  // when the file could not be read.
+  bool update(std::vector<irq_source_t>& sources, float seconds);
+  // Rows parsed by the last update, the others were unchanged
+  size_t parsed() const;
+
+private:
+  struct row_t {
+    size_t offset; // in the buffer
+    size_t length;
+    size_t name_offset; // leading blanks skipped, colon excluded
+    size_t name_length;
+  };
+
+  bool read();
+  void parse_row(const row_t& row, irq_source_t& source) const;
+
+  int m_fd;
+  int m_cpus;
+  std::vector<int> m_cpu_ids;
+  bool m_cpus_changed; // by the last read
+  size_t m_parsed;
+  // Current and previous contents, swapped after each update
+  std::vector<char> m_buffer;
+  size_t m_size;
+  std::vector<row_t> m_rows;
+  std::vector<char> m_previous;
+  std::vector<row_t> m_previous_rows;
+  std::vector<uint64_t> m_last; // counts of the row being parsed
+};
+
+#endif
@@ -1,5 +1,4 @@
 #include "imgui.h"
-#include "imgui_freetype.h"
 #include "imgui_impl_glfw.h"
 #include "imgui_impl_opengl3.h"
 
@@ -8,20 +7,56 @@
 #include <array>
 #include <chrono>
 #include <cmath>
+#include <functional>
 #include <iostream>
 #include <memory>
 #include <numeric>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
 
 #include "draw_app.hpp"
-#include "seguiemj.font.hpp"
+#include "fonts.hpp"
 
 const float REFRESH_RATE = 1.0f;
 
+typedef std::chrono::steady_clock startup_clock;
+
+static bool startup_trace = false;
+static startup_clock::time_point startup_time;
+
 static void glfw_error_callback(int error, const char* description) {
   fprintf(stderr, "GLFW Error %d: %s\n", error, description);
 }
 
-int main(int, char**) {
+static void trace_phase(const char* phase, startup_clock::time_point begin) {
+  if (!startup_trace)
+    return;
+
+  const startup_clock::time_point end = startup_clock::now();
+  const std::chrono::duration<double, std::milli> took = end - begin;
+  const std::chrono::duration<double, std::milli> at = end - startup_time;
+  fprintf(stderr, "[startup] %-16s %8.2f ms (at %8.2f ms)\n", phase,
+          took.count(), at.count());
+}
+
+static void startup_ready(RefreshData* rd, bool& ready) {
+  std::lock_guard<std::mutex> lock(rd->mutex);
+  ready = true;
+}
+
+int main(int argc, char** argv) {
+  startup_time = startup_clock::now();
+
+  int scan_workers = 0;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--startup-trace") == 0)
+      startup_trace = true;
+    else if (strcmp(argv[i], "--scan-workers") == 0 && i + 1 < argc)
+      scan_workers = atoi(argv[++i]);
+  }
+
+  startup_clock::time_point phase = startup_clock::now();
   glfwSetErrorCallback(glfw_error_callback);
 
   if (!glfwInit())
@@ -44,6 +79,9 @@ int main(int, char**) {
   // only glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE); // 3.0+ only
 #endif
 
+  trace_phase("glfw", phase);
+
+  phase = startup_clock::now();
   GLFWwindow* window =
       glfwCreateWindow(1280, 720, "system-monitor", nullptr, nullptr);
   if (window == nullptr)
@@ -52,6 +90,9 @@ int main(int, char**) {
   glfwMakeContextCurrent(window);
   glfwSwapInterval(1); // Enable vsync
 
+  trace_phase("window", phase);
+
+  phase = startup_clock::now();
   IMGUI_CHECKVERSION();
   ImGui::CreateContext();
   ImGuiIO& io = ImGui::GetIO();
@@ -63,81 +104,116 @@ int main(int, char**) {
   ImGui_ImplGlfw_InitForOpenGL(window, true);
   ImGui_ImplOpenGL3_Init(glsl_version);
 
-  io.Fonts->AddFontDefault();
-  static ImWchar ranges[] = {0x1, 0x1FFFF, 0};
-  static ImFontConfig cfg;
-  cfg.OversampleH = cfg.OversampleV = 1;
-  cfg.MergeMode = true;
-  cfg.FontBuilderFlags |= ImGuiFreeTypeBuilderFlags_LoadColor;
-  io.Fonts->AddFontFromMemoryCompressedBase85TTF(
-      SegoeUIEmoji_compressed_data_base85, 13.0f, &cfg, ranges);
+  fonts_setup(io.Fonts);
+  trace_phase("imgui", phase);
 
   ImVec4 clear_color = ImVec4(0.1f, 0.1f, 0.1f, 0.0f);
 
-  std::shared_ptr<RefreshData> refresh_data_ptr = RefreshData::init();
-
+  std::shared_ptr<RefreshData> refresh_data_ptr =
+      RefreshData::init(scan_workers);
   RefreshData* rd = refresh_data_ptr.get();
-  rd->refresh_operating_system();
-  rd->refresh_user();
-  rd->refresh_hostname();
-  rd->refresh_cpu_info();
-
-  assert(rd->setup_refresh_battery("/sys/class/power_supply/BAT0/energy_now",
-                                   "/sys/class/power_supply/BAT0/energy_full",
-                                   "/sys/class/power_supply/BAT0/status"));
-  assert(rd->setup_refresh_thermal("/sys/class/thermal/thermal_zone0/temp"));
-  assert(rd->setup_refresh_fan("/sys/class/hwmon/hwmon6/fan1_input"));
-  assert(rd->setup_proc());
-
-  rd->refresh_cpu_stat(true);
-  rd->refresh_cpu_graph_stat(true);
-  rd->refresh_processes(true);
-  rd->refresh_battery_full();
-
-  float refresh_rate = REFRESH_RATE, refresh_accumulator = refresh_rate;
-  while (!glfwWindowShouldClose(window)) {
-    glfwPollEvents();
 
-    if (refresh_accumulator >= refresh_rate) {
-      RefreshData* refresh_data = refresh_data_ptr.get();
-      refresh_data->refresh_cpu_stat();
-      refresh_data->refresh_memory();
-      refresh_data->refresh_storages();
-      refresh_data->refresh_interfaces();
-
-      // Do not refresh the processes if there is a selection
-      if (refresh_data->processes_selection.size() == 0) {
-        refresh_data->refresh_processes();
-      }
-
-      if (!rd->graph.animated) {
-        refresh_data->refresh_battery();
-        refresh_data->refresh_thermal();
-        refresh_data->refresh_fan();
-      }
-
-      refresh_accumulator = 0.0;
+  // The collectors are set up on the scheduler workers while the first
+  // frames are shown, the sections are drawn as "Loading..." until ready.
+  std::vector<std::pair<const char*, std::function<void()>>> startup = {
+      {"system",
+       [rd]() {
+         rd->refresh_operating_system();
+         rd->refresh_user();
+         rd->refresh_hostname();
+         rd->refresh_cpu_info();
+         startup_ready(rd, rd->ready.system);
+       }},
+      {"cpu",
+       [rd]() {
+         if (!rd->setup_proc())
+           fprintf(stderr, "could not open /proc/stat or /proc/meminfo\n");
+         rd->refresh_cpu_stat(true);
+         rd->refresh_cpu_graph_stat(true);
+         rd->setup_perf_counters();
+         rd->setup_schedstat();
+         rd->setup_interrupts();
+         startup_ready(rd, rd->ready.cpu);
+       }},
+      {"sensors",
+       [rd]() {
+         rd->setup_sensors();
+         rd->setup_cpufreq();
+         rd->setup_rapl();
+         rd->refresh_sensors();
+         startup_ready(rd, rd->ready.sensors);
+       }},
+      {"memory",
+       [rd]() {
+         rd->refresh_memory();
+         rd->refresh_vmstat();
+         rd->refresh_slabinfo();
+         rd->setup_numa();
+         startup_ready(rd, rd->ready.memory);
+       }},
+      {"pressure",
+       [rd]() {
+         rd->setup_pressure();
+         rd->refresh_pressure();
+         startup_ready(rd, rd->ready.pressure);
+       }},
+      {"cgroups",
+       [rd]() {
+         rd->setup_cgroups();
+         rd->refresh_cgroups();
+         startup_ready(rd, rd->ready.cgroups);
+       }},
+      {"storages",
+       [rd]() {
+         rd->refresh_storages();
+         startup_ready(rd, rd->ready.storages);
+       }},
+      {"network",
+       [rd]() {
+         rd->refresh_interfaces();
+         rd->setup_net_stats();
+         startup_ready(rd, rd->ready.network);
+       }},
+      {"processes",
+       [rd]() {
+         rd->refresh_processes(true);
+         startup_ready(rd, rd->ready.processes);
+       }},
+  };
+
+  rd->scheduler->run_once("startup", COLLECTOR_EXPENSIVE, [rd, startup]() {
+    for (const auto& phase : startup) {
+      const startup_clock::time_point begin = startup_clock::now();
+      phase.second();
+      trace_phase(phase.first, begin);
     }
-    refresh_accumulator += io.DeltaTime;
 
-    if (rd->graph.refresh_accumulator >= (1.f / rd->graph.fps) &&
-        rd->graph.animated) {
-      RefreshData* refresh_data = refresh_data_ptr.get();
-      refresh_data->refresh_cpu_graph_stat();
-      refresh_data->refresh_battery();
-      refresh_data->refresh_thermal();
-      refresh_data->refresh_fan();
+    rd->start_collectors(REFRESH_RATE);
+    trace_phase("complete", startup_time);
+  });
 
-      rd->graph.refresh_accumulator = 0.0;
+  bool first_frame = true;
+  while (!glfwWindowShouldClose(window)) {
+    glfwPollEvents();
+
+    // Rasterize the glyphs requested during the previous frame
+    if (fonts_rebuild(io.Fonts)) {
+      ImGui_ImplOpenGL3_DestroyFontsTexture();
+      ImGui_ImplOpenGL3_CreateFontsTexture();
     }
-    rd->graph.refresh_accumulator += io.DeltaTime;
 
     ImGui_ImplOpenGL3_NewFrame();
     ImGui_ImplGlfw_NewFrame();
     ImGui::NewFrame();
 
     ImVec2 display = io.DisplaySize;
-    draw_app(refresh_data_ptr, display);
+    // The widgets read the published data in place, so the collectors wait
+    // for the frame to be built before publishing. Only the ImGui draw lists
+    // are built under the lock, the GL rendering happens after.
+    {
+      std::lock_guard<std::mutex> lock(rd->mutex);
+      draw_app(refresh_data_ptr, display);
+    }
     ImGui::Render();
 
     int display_w, display_h;
@@ -149,11 +225,20 @@ int main(int, char**) {
     ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
 
     glfwSwapBuffers(window);
+
+    if (first_frame) {
+      trace_phase("first frame", startup_time);
+      first_frame = false;
+    }
   }
 
+  rd->scheduler->stop();
+
+  draw_app_shutdown();
   ImGui_ImplOpenGL3_Shutdown();
   ImGui_ImplGlfw_Shutdown();
   ImGui::DestroyContext();
+  fonts_shutdown();
 
   glfwDestroyWindow(window);
   glfwTerminate();
@@ -0,0 +1,90 @@
+#include "netstat.hpp"
+
+#include <sstream>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+
+static const struct {
+  const char* group;
+  const char* field;
+  const char* name;
+} NET_COUNTERS_FIELDS[NET_COUNTERS] = {
+    {"Tcp", "RetransSegs", "TCP retransmits"},
+    {"Tcp", "InErrs", "TCP receive errors"},
+    {"Tcp", "OutRsts", "TCP resets sent"},
+    {"TcpExt", "TCPTimeouts", "TCP timeouts"},
+    {"TcpExt", "ListenDrops", "TCP listen drops"},
+    {"TcpExt", "ListenOverflows", "TCP accept queue overflows"},
+    {"TcpExt", "TCPBacklogDrop", "TCP backlog drops"},
+    {"Udp", "InErrors", "UDP receive errors"},
+    {"Udp", "RcvbufErrors", "UDP receive buffer errors"},
+    {"Udp", "SndbufErrors", "UDP send buffer errors"},
+    {"Udp", "NoPorts", "UDP to closed ports"},
+    {"Ip", "InDiscards", "IP input discards"},
+};
+
+const char* net_counter_name(net_counter_t counter) {
+  return NET_COUNTERS_FIELDS[counter].name;
+}
+
+std::vector<softnet_cpu_t> read_softnet_stat(std::istream& is) {
+  std::vector<softnet_cpu_t> cpus;
+  std::string line;
+  while (std::getline(is, line)) {
+    uint64_t fields[13] = {};
+    int count = 0;
+    const char* p = line.c_str();
+    for (char* end; count < 13; p = end) {
+      fields[count] = strtoull(p, &end, 16);
+      if (end == p)
+        break;
+      count++;
+    }
+    if (count < 3)
+      continue;
+
+    softnet_cpu_t cpu;
+    cpu.cpu = count >= 13 ? (int)fields[12] : (int)cpus.size();
+    cpu.processed = fields[0];
+    cpu.dropped = fields[1];
+    cpu.time_squeeze = fields[2];
+    cpu.received_rps = fields[9];
+    cpu.flow_limit = fields[10];
+    cpus.push_back(cpu);
+  }
+
+  is.clear();
+  is.seekg(std::ios::beg);
+  return cpus;
+}
+
+void read_net_counters(std::istream& is,
+                       std::array<uint64_t, NET_COUNTERS>& counters,
+                       std::array<bool, NET_COUNTERS>& present) {
+  std::string names, values;
+  while (std::getline(is, names) && std::getline(is, values)) {
+    const size_t colon = names.find(':');
+    if (colon == std::string::npos ||
+        values.compare(0, colon + 1, names, 0, colon + 1) != 0)
+      continue;
+    const std::string group = names.substr(0, colon);
+
+    std::istringstream name_stream(names.substr(colon + 1));
+    std::istringstream value_stream(values.substr(colon + 1));
+    std::string name;
+    long long value; // a few, such as Tcp MaxConn, are signed
+    while (name_stream >> name && value_stream >> value) {
+      for (int i = 0; i < NET_COUNTERS; i++) {
+        if (group == NET_COUNTERS_FIELDS[i].group &&
+            name == NET_COUNTERS_FIELDS[i].field) {
+          counters[i] = value;
+          present[i] = true;
+        }
+      }
+    }
+  }
+
+  is.clear();
+  is.seekg(std::ios::beg);
+}
@@ -0,0 +1,48 @@
+#ifndef __NETSTAT_HPP__
+#define __NETSTAT_HPP__
+
+#include <array>
+#include <istream>
+#include <stdint.h>
+#include <vector>
+
+// A line of /proc/net/softnet_stat
+struct softnet_cpu_t {
+  int cpu;
+  uint64_t processed;    // packets taken from the backlog
+  uint64_t dropped;      // the backlog was full
+  uint64_t time_squeeze; // net_rx_action ran out of budget or time
+  uint64_t received_rps; // woken up by another CPU through RPS
+  uint64_t flow_limit;   // dropped by the flow limit
+};
+
+// Error counters of /proc/net/snmp and /proc/net/netstat
+enum net_counter_t {
+  NET_TCP_RETRANSMITS,
+  NET_TCP_IN_ERRORS,
+  NET_TCP_RESETS_SENT,
+  NET_TCP_TIMEOUTS,
+  NET_TCP_LISTEN_DROPS,
+  NET_TCP_LISTEN_OVERFLOWS,
+  NET_TCP_BACKLOG_DROPS,
+  NET_UDP_IN_ERRORS,
+  NET_UDP_RCVBUF_ERRORS,
+  NET_UDP_SNDBUF_ERRORS,
+  NET_UDP_NO_PORTS,
+  NET_IP_IN_DISCARDS,
+  NET_COUNTERS,
+};
+
+const char* net_counter_name(net_counter_t counter);
+
+// One line per CPU, in hexadecimal. The CPU number is only given by recent
+// kernels, the line index is used otherwise.
+std::vector<softnet_cpu_t> read_softnet_stat(std::istream& is);
+
+// "<Group>: <names>..." lines followed by "<Group>: <values>..." ones. The
+// counters found are set, the others are left untouched.
+void read_net_counters(std::istream& is,
+                       std::array<uint64_t, NET_COUNTERS>& counters,
+                       std::array<bool, NET_COUNTERS>& present);
+
+#endif
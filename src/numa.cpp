@@ -0,0 +1,100 @@
+#include "numa.hpp"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <stdlib.h>
+#include <string.h>
+
+std::vector<int> numa_nodes(const std::string& root) {
+  std::vector<int> nodes;
+  std::error_code ec;
+  for (const auto& entry : std::filesystem::directory_iterator(root, ec)) {
+    const std::string name = entry.path().filename().string();
+    if (name.compare(0, 4, "node") != 0 || name.size() == 4 ||
+        strspn(name.c_str() + 4, "0123456789") != name.size() - 4)
+      continue;
+    nodes.push_back(atoi(name.c_str() + 4));
+  }
+
+  std::sort(nodes.begin(), nodes.end());
+  return nodes;
+}
+
+std::string numa_node_path(int node, const char* file,
+                           const std::string& root) {
+  return root + "/node" + std::to_string(node) + "/" + file;
+}
+
+// "Node 0 MemTotal:        4685560 kB" per line
+void parse_numa_meminfo(const std::string& text, numa_node_stat_t& stat) {
+  std::istringstream iss(text);
+  std::string line;
+  while (std::getline(iss, line)) {
+    char key[64];
+    unsigned long long value;
+    if (sscanf(line.c_str(), "Node %*d %63[^:]: %llu", key, &value) != 2)
+      continue;
+
+    if (strcmp(key, "MemTotal") == 0)
+      stat.mem_total = value * 1024;
+    else if (strcmp(key, "MemFree") == 0)
+      stat.mem_free = value * 1024;
+    else if (strcmp(key, "FilePages") == 0)
+      stat.file_pages = value * 1024;
+    else if (strcmp(key, "AnonPages") == 0)
+      stat.anon_pages = value * 1024;
+  }
+}
+
+void parse_numastat(const std::string& text, numa_node_stat_t& stat) {
+  std::istringstream iss(text);
+  std::string key;
+  uint64_t value;
+  while (iss >> key >> value) {
+    if (key == "numa_hit")
+      stat.numa_hit = value;
+    else if (key == "numa_miss")
+      stat.numa_miss = value;
+    else if (key == "numa_foreign")
+      stat.numa_foreign = value;
+    else if (key == "local_node")
+      stat.local_node = value;
+    else if (key == "other_node")
+      stat.other_node = value;
+  }
+}
+
+bool read_numa_maps(pid_t pid, std::map<int, uint64_t>& nodes) {
+  nodes.clear();
+  std::ifstream file("/proc/" + std::to_string(pid) + "/numa_maps");
+  if (!file.is_open())
+    return false;
+
+  // "<address> <policy> [file=...] anon=1 dirty=1 N0=1 kernelpagesize_kB=4"
+  std::string line;
+  std::vector<std::pair<int, uint64_t>> pages;
+  while (std::getline(file, line)) {
+    pages.clear();
+    uint64_t page_size = 4096;
+
+    const char* p = line.c_str();
+    while ((p = strchr(p, ' '))) {
+      p++;
+      if (p[0] == 'N' && p[1] >= '0' && p[1] <= '9') {
+        char* end;
+        const int node = strtol(p + 1, &end, 10);
+        if (*end == '=')
+          pages.push_back({node, strtoull(end + 1, nullptr, 10)});
+      } else if (strncmp(p, "kernelpagesize_kB=", 18) == 0) {
+        page_size = strtoull(p + 18, nullptr, 10) * 1024;
+      }
+    }
+
+    for (const auto& entry : pages)
+      nodes[entry.first] += entry.second * page_size;
+  }
+
+  return !file.bad();
+}
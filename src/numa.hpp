@@ -0,0 +1,42 @@
+#ifndef __NUMA_HPP__
+#define __NUMA_HPP__
+
+#include <map>
+#include <stdint.h>
+#include <string>
+#include <sys/types.h>
+#include <vector>
+
+struct numa_node_stat_t {
+  int node;
+
+  // node<N>/meminfo, in bytes
+  uint64_t mem_total;
+  uint64_t mem_free;
+  uint64_t file_pages;
+  uint64_t anon_pages;
+
+  // node<N>/numastat, pages allocated since boot
+  uint64_t numa_hit;     // on this node as intended
+  uint64_t numa_miss;    // on this node, intended for another one
+  uint64_t numa_foreign; // intended for this node, allocated elsewhere
+  uint64_t local_node;   // by a process running on this node
+  uint64_t other_node;   // by a process running on another node
+};
+
+// Nodes below root, in order, empty without NUMA support
+std::vector<int>
+numa_nodes(const std::string& root = "/sys/devices/system/node");
+std::string
+numa_node_path(int node, const char* file,
+               const std::string& root = "/sys/devices/system/node");
+
+void parse_numa_meminfo(const std::string& text, numa_node_stat_t& stat);
+void parse_numastat(const std::string& text, numa_node_stat_t& stat);
+
+// Bytes of each node mapped by the process, from the N<node>=<pages> fields
+// of /proc/<pid>/numa_maps. Walks the page tables of the process, which takes
+// a while for large ones.
+bool read_numa_maps(pid_t pid, std::map<int, uint64_t>& nodes);
+
+#endif
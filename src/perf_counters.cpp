@@ -0,0 +1,182 @@
+#include "perf_counters.hpp"
+
+#include <errno.h>
+#include <linux/perf_event.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+struct perf_event_t {
+  uint32_t type;
+  uint64_t config;
+};
+
+static const perf_event_t PERF_EVENTS[PERF_COUNTERS] = {
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_REFERENCES},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_INSTRUCTIONS},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_STALLED_CYCLES_FRONTEND},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_STALLED_CYCLES_BACKEND},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+    {PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CONTEXT_SWITCHES},
+    {PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS},
+    {PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CPU_MIGRATIONS},
+};
+
+// The first counter of each list leads its group. Two or three events fit
+// the general purpose counters left by the NMI watchdog, on Intel as on AMD.
+static const perf_counter_t IPC_GROUP[] = {PERF_CYCLES, PERF_INSTRUCTIONS};
+static const perf_counter_t CACHE_GROUP[] = {PERF_CACHE_REFERENCES,
+                                             PERF_CACHE_MISSES};
+static const perf_counter_t BRANCH_GROUP[] = {PERF_BRANCHES,
+                                              PERF_BRANCH_MISSES};
+static const perf_counter_t STALL_GROUP[] = {
+    PERF_STALL_CYCLES,
+    PERF_STALLED_FRONTEND,
+    PERF_STALLED_BACKEND,
+};
+
+static const perf_counter_t SOFTWARE_GROUP[] = {
+    PERF_CONTEXT_SWITCHES,
+    PERF_PAGE_FAULTS,
+    PERF_CPU_MIGRATIONS,
+};
+
+static int perf_event_open(perf_counter_t counter, int core, int group) {
+  struct perf_event_attr attr;
+  memset(&attr, 0, sizeof(attr));
+  attr.size = sizeof(attr);
+  attr.type = PERF_EVENTS[counter].type;
+  attr.config = PERF_EVENTS[counter].config;
+  attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED |
+                     PERF_FORMAT_TOTAL_TIME_RUNNING;
+  attr.disabled = group < 0;
+
+  return (int)syscall(__NR_perf_event_open, &attr, -1, core, group,
+                      PERF_FLAG_FD_CLOEXEC);
+}
+
+PerfCounters::PerfCounters(int cores)
+    : m_mode(PERF_UNAVAILABLE), m_error(0), m_cores(cores) {
+  const struct {
+    const perf_counter_t* counters;
+    int count;
+  } optional[] = {
+      {CACHE_GROUP, sizeof(CACHE_GROUP) / sizeof(CACHE_GROUP[0])},
+      {BRANCH_GROUP, sizeof(BRANCH_GROUP) / sizeof(BRANCH_GROUP[0])},
+      {STALL_GROUP, sizeof(STALL_GROUP) / sizeof(STALL_GROUP[0])},
+  };
+
+  // The IPC group decides whether the hardware counters are usable, the
+  // others are kept where the CPU has their events
+  bool opened = true;
+  for (int core = 0; core < cores && opened; core++)
+    opened = open_group(core, IPC_GROUP,
+                        sizeof(IPC_GROUP) / sizeof(IPC_GROUP[0]), false);
+
+  if (opened) {
+    m_mode = PERF_HARDWARE;
+    for (int core = 0; core < cores; core++)
+      for (const auto& group : optional)
+        open_group(core, group.counters, group.count, true);
+  } else {
+    close_all();
+    opened = true;
+    for (int core = 0; core < cores && opened; core++)
+      opened = open_group(core, SOFTWARE_GROUP,
+                          sizeof(SOFTWARE_GROUP) / sizeof(SOFTWARE_GROUP[0]),
+                          false);
+    if (opened)
+      m_mode = PERF_SOFTWARE;
+    else
+      close_all();
+  }
+
+  for (const group_t& group : m_groups) {
+    ioctl(group.leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(group.leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+  }
+}
+
+PerfCounters::~PerfCounters() { close_all(); }
+
+bool PerfCounters::open_group(int core, const perf_counter_t* counters,
+                              int count, bool optional) {
+  const int leader = perf_event_open(counters[0], core, -1);
+  if (leader < 0) {
+    if (!optional)
+      m_error = errno;
+    return false;
+  }
+
+  group_t group;
+  group.core = core;
+  group.leader = leader;
+  group.members.push_back(counters[0]);
+  std::vector<int> fds = {leader};
+
+  // Members the CPU does not have (e.g. stalled cycles on most Intel cores)
+  // are left out of the group
+  for (int i = 1; i < count; i++) {
+    const int fd = perf_event_open(counters[i], core, leader);
+    if (fd < 0)
+      continue;
+    fds.push_back(fd);
+    group.members.push_back(counters[i]);
+  }
+
+  // A leader alone is of no use to the ratios
+  if (optional && group.members.size() < 2) {
+    for (int fd : fds)
+      close(fd);
+    return false;
+  }
+
+  m_fds.insert(m_fds.end(), fds.begin(), fds.end());
+  m_groups.push_back(group);
+  return true;
+}
+
+void PerfCounters::close_all() {
+  for (int fd : m_fds)
+    close(fd);
+  m_fds.clear();
+  m_groups.clear();
+}
+
+bool PerfCounters::read(std::vector<perf_values_t>& cores) {
+  cores.assign(m_cores, perf_values_t{});
+  if (m_mode == PERF_UNAVAILABLE)
+    return false;
+
+  // { nr, time_enabled, time_running, values[nr] }
+  uint64_t buffer[3 + PERF_COUNTERS];
+  for (const group_t& group : m_groups) {
+    const ssize_t length = ::read(group.leader, buffer, sizeof(buffer));
+    if (length < (ssize_t)(3 * sizeof(uint64_t)))
+      continue;
+
+    const uint64_t nr = buffer[0];
+    const uint64_t enabled = buffer[1];
+    const uint64_t running = buffer[2];
+    // Not scheduled yet, the PMU is taken by other users
+    if (running == 0)
+      continue;
+
+    perf_values_t& core = cores[group.core];
+    for (uint64_t i = 0; i < nr && i < group.members.size(); i++) {
+      double value = buffer[3 + i];
+      if (running < enabled)
+        value = value * enabled / running;
+
+      core.present[group.members[i]] = true;
+      core.values[group.members[i]] = (uint64_t)value;
+    }
+  }
+
+  return true;
+}
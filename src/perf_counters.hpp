@@ -0,0 +1,72 @@
+#ifndef __PERF_COUNTERS_HPP__
+#define __PERF_COUNTERS_HPP__
+
+#include <stdint.h>
+#include <vector>
+
+enum perf_counter_t {
+  // Hardware
+  PERF_CYCLES,
+  PERF_INSTRUCTIONS,
+  PERF_CACHE_REFERENCES,
+  PERF_CACHE_MISSES,
+  PERF_BRANCHES,
+  PERF_BRANCH_MISSES,
+  PERF_STALLED_FRONTEND,
+  PERF_STALLED_BACKEND,
+  PERF_STALL_CYCLES, // cycles again, in the group of the stalls
+  // Software, used when the hardware ones are not available (VMs)
+  PERF_CONTEXT_SWITCHES,
+  PERF_PAGE_FAULTS,
+  PERF_CPU_MIGRATIONS,
+  PERF_COUNTERS,
+};
+
+enum perf_mode_t {
+  PERF_UNAVAILABLE,
+  PERF_HARDWARE,
+  PERF_SOFTWARE,
+};
+
+// Counter values of a core since the counters were opened, scaled when the
+// group was multiplexed with other users of the PMU
+struct perf_values_t {
+  bool present[PERF_COUNTERS];
+  uint64_t values[PERF_COUNTERS];
+};
+
+// Small counter groups per core, each read with PERF_FORMAT_GROUP: a single
+// read() returns the counters of a group, sampled over the same window, so
+// the ratios are computed within a group. A group is scheduled all or
+// nothing, a single one holding every counter would never fit in the PMU of
+// most CPUs. Counting every task on a core needs perf_event_paranoid <= 0 or
+// CAP_PERFMON.
+class PerfCounters {
+public:
+  PerfCounters(int cores);
+  ~PerfCounters();
+
+  perf_mode_t mode() const { return m_mode; }
+  int error() const { return m_error; } // errno of the failed open
+
+  bool read(std::vector<perf_values_t>& cores);
+
+private:
+  struct group_t {
+    int core;
+    int leader;
+    std::vector<perf_counter_t> members; // in the order of the group
+  };
+
+  bool open_group(int core, const perf_counter_t* counters, int count,
+                  bool optional);
+  void close_all();
+
+  perf_mode_t m_mode;
+  int m_error;
+  int m_cores;
+  std::vector<group_t> m_groups;
+  std::vector<int> m_fds;
+};
+
+#endif
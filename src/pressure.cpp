@@ -0,0 +1,120 @@
+#include "pressure.hpp"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+// 100 ms of stall within 2 s. Unprivileged users may only use windows which
+// are multiples of 2 s.
+const char* PRESSURE_TRIGGER = "some 100000 2000000";
+
+static const char* PRESSURE_NAMES[PRESSURE_RESOURCES] = {"cpu", "memory", "io"};
+
+const char* pressure_name(pressure_resource_t resource) {
+  return PRESSURE_NAMES[resource];
+}
+
+std::string pressure_path(pressure_resource_t resource,
+                          const std::string& root) {
+  return root + "/" + PRESSURE_NAMES[resource];
+}
+
+bool read_pressure(std::istream& is, pressure_sample_t& sample) {
+  sample = pressure_sample_t{};
+
+  // The "full" line is absent from the cpu file before 5.13
+  std::string line;
+  while (std::getline(is, line)) {
+    pressure_line_t* target = nullptr;
+    if (line.rfind("some ", 0) == 0)
+      target = &sample.some;
+    else if (line.rfind("full ", 0) == 0)
+      target = &sample.full;
+    else
+      continue;
+
+    unsigned long long total = 0;
+    if (sscanf(line.c_str() + 5, "avg10=%f avg60=%f avg300=%f total=%llu",
+               &target->avg10, &target->avg60, &target->avg300, &total) != 4)
+      return false;
+    target->total = total;
+    sample.success = true;
+  }
+
+  return sample.success;
+}
+
+PressureTriggers::PressureTriggers(
+    std::function<void(pressure_resource_t)> on_stall, const std::string& root)
+    : m_on_stall(std::move(on_stall)) {
+  bool any = false;
+  for (int i = 0; i < PRESSURE_RESOURCES; i++) {
+    const std::string path = pressure_path((pressure_resource_t)i, root);
+    m_fds[i] = open(path.c_str(), O_RDWR | O_NONBLOCK | O_CLOEXEC);
+    if (m_fds[i] < 0)
+      continue;
+
+    // The trigger lives as long as the descriptor
+    if (write(m_fds[i], PRESSURE_TRIGGER, strlen(PRESSURE_TRIGGER) + 1) < 0) {
+      close(m_fds[i]);
+      m_fds[i] = -1;
+      continue;
+    }
+    any = true;
+  }
+
+  m_wake = any ? eventfd(0, EFD_CLOEXEC) : -1;
+  if (m_wake >= 0)
+    m_thread = std::thread(&PressureTriggers::loop, this);
+}
+
+PressureTriggers::~PressureTriggers() {
+  if (m_thread.joinable()) {
+    const uint64_t one = 1;
+    if (write(m_wake, &one, sizeof(one)) == sizeof(one))
+      m_thread.join();
+    else
+      m_thread.detach();
+  }
+
+  if (m_wake >= 0)
+    close(m_wake);
+  for (int i = 0; i < PRESSURE_RESOURCES; i++) {
+    if (m_fds[i] >= 0)
+      close(m_fds[i]);
+  }
+}
+
+bool PressureTriggers::armed(pressure_resource_t resource) const {
+  return m_fds[resource] >= 0;
+}
+
+void PressureTriggers::loop() {
+  struct pollfd fds[PRESSURE_RESOURCES + 1];
+  for (int i = 0; i < PRESSURE_RESOURCES; i++)
+    fds[i] = pollfd{m_fds[i], POLLPRI, 0};
+  fds[PRESSURE_RESOURCES] = pollfd{m_wake, POLLIN, 0};
+
+  for (;;) {
+    if (poll(fds, PRESSURE_RESOURCES + 1, -1) < 0) {
+      if (errno == EINTR)
+        continue;
+      return;
+    }
+
+    if (fds[PRESSURE_RESOURCES].revents)
+      return;
+
+    for (int i = 0; i < PRESSURE_RESOURCES; i++) {
+      if (fds[i].revents & POLLERR) {
+        fds[i].fd = -1; // The file went away, stop polling it
+      } else if (fds[i].revents & POLLPRI) {
+        m_on_stall((pressure_resource_t)i);
+      }
+    }
+  }
+}
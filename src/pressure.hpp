@@ -0,0 +1,59 @@
+#ifndef __PRESSURE_HPP__
+#define __PRESSURE_HPP__
+
+#include <functional>
+#include <istream>
+#include <stdint.h>
+#include <string>
+#include <thread>
+
+enum pressure_resource_t {
+  PRESSURE_CPU,
+  PRESSURE_MEMORY,
+  PRESSURE_IO,
+  PRESSURE_RESOURCES,
+};
+
+struct pressure_line_t {
+  float avg10; // percents
+  float avg60;
+  float avg300;
+  uint64_t total; // microseconds stalled since boot
+};
+
+// One of /proc/pressure/{cpu,memory,io}. "some" is the time at least one task
+// was stalled, "full" the time all non-idle tasks were.
+struct pressure_sample_t {
+  bool success;
+  pressure_line_t some;
+  pressure_line_t full;
+};
+
+const char* pressure_name(pressure_resource_t resource);
+std::string pressure_path(pressure_resource_t resource,
+                          const std::string& root = "/proc/pressure");
+
+bool read_pressure(std::istream& is, pressure_sample_t& sample);
+
+// PSI triggers: the kernel wakes up a poll() for POLLPRI as soon as the "some"
+// stall of a resource exceeds the threshold within the window, instead of the
+// stall being noticed on the next periodic read.
+class PressureTriggers {
+public:
+  PressureTriggers(std::function<void(pressure_resource_t)> on_stall,
+                   const std::string& root = "/proc/pressure");
+  ~PressureTriggers();
+
+  // Unprivileged triggers need a kernel >= 6.5, false when not registered
+  bool armed(pressure_resource_t resource) const;
+
+private:
+  void loop();
+
+  std::function<void(pressure_resource_t)> m_on_stall;
+  int m_fds[PRESSURE_RESOURCES];
+  int m_wake; // eventfd, written to stop the thread
+  std::thread m_thread;
+};
+
+#endif
@@ -0,0 +1,558 @@
+#include "profiler.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cxxabi.h>
+#include <dirent.h>
+#include <elf.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <fstream>
+#include <linux/perf_event.h>
+#include <poll.h>
+#include <sstream>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <unordered_map>
+#include <unordered_set>
+
+static const int SAMPLE_FREQUENCY = 199; // Hz, off the common timer periods
+static const int RING_PAGES = 16;        // per thread, a power of two
+static const int MAX_THREADS = 256;
+static const int MAX_IMAGES = 256;
+
+struct elf_image_t {
+  struct segment_t {
+    uint64_t offset;
+    uint64_t vaddr;
+    uint64_t size;
+  };
+
+  struct symbol_t {
+    uint64_t address;
+    uint64_t size;
+    uint32_t name; // offset in strings
+  };
+
+  std::vector<segment_t> segments; // PT_LOAD
+  std::vector<symbol_t> symbols;   // functions, by address
+  std::string strings;
+};
+
+struct mapping_t {
+  uint64_t start;
+  uint64_t end;
+  uint64_t offset;
+  std::string key; // device and inode
+  std::string path;
+};
+
+// Executable file mappings, by address
+static std::vector<mapping_t> read_maps(pid_t pid) {
+  std::vector<mapping_t> maps;
+  std::ifstream file("/proc/" + std::to_string(pid) + "/maps");
+  std::string line;
+  while (std::getline(file, line)) {
+    std::istringstream ss(line);
+    std::string range, perms, device, path;
+    uint64_t offset, inode;
+    ss >> range >> perms >> std::hex >> offset >> device >> std::dec >> inode;
+    std::getline(ss >> std::ws, path);
+    if (!ss.eof() && ss.fail())
+      continue;
+    if (perms.size() < 3 || perms[2] != 'x' || inode == 0 || path.empty() ||
+        path[0] != '/')
+      continue;
+
+    mapping_t mapping;
+    mapping.start = strtoull(range.c_str(), nullptr, 16);
+    mapping.end = strtoull(range.c_str() + range.find('-') + 1, nullptr, 16);
+    mapping.offset = offset;
+    mapping.key = device + ":" + std::to_string(inode);
+    mapping.path = path;
+    maps.push_back(mapping);
+  }
+
+  std::sort(maps.begin(), maps.end(),
+            [](const mapping_t& a, const mapping_t& b) {
+              return a.start < b.start;
+            });
+  return maps;
+}
+
+static const mapping_t* find_mapping(const std::vector<mapping_t>& maps,
+                                     uint64_t address) {
+  auto it = std::upper_bound(
+      maps.begin(), maps.end(), address,
+      [](uint64_t address, const mapping_t& m) { return address < m.start; });
+  if (it == maps.begin())
+    return nullptr;
+  --it;
+  return address < it->end ? &*it : nullptr;
+}
+
+// Only 64 bits ELF files are supported, .symtab is preferred over .dynsym
+static bool load_image(const std::string& path, elf_image_t& image);
+
+Profiler::Profiler() : m_running(false) {
+  m_wake = eventfd(0, EFD_CLOEXEC);
+}
+
+Profiler::~Profiler() {
+  if (m_thread.joinable()) {
+    const uint64_t one = 1;
+    if (write(m_wake, &one, sizeof(one)) == sizeof(one))
+      m_thread.join();
+    else
+      m_thread.detach();
+  }
+
+  if (m_wake >= 0)
+    close(m_wake);
+}
+
+bool Profiler::start(pid_t pid, const std::string& name, float seconds,
+                     std::function<void(profile_t)> done) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  if (m_running || m_wake < 0)
+    return false;
+
+  if (m_thread.joinable())
+    m_thread.join();
+
+  m_running = true;
+  m_thread = std::thread([this, pid, name, seconds, done]() {
+    profile_t profile = {};
+    profile.pid = pid;
+    profile.name = name;
+    const bool finished = run(pid, seconds, profile);
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_running = false;
+    }
+    if (finished)
+      done(std::move(profile));
+  });
+  return true;
+}
+
+bool Profiler::running() {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_running;
+}
+
+struct ring_t {
+  int fd;
+  char* base;
+  size_t size; // of the data area
+};
+
+static void copy_ring(const ring_t& ring, uint64_t position, void* dst,
+                      size_t length) {
+  const char* data = ring.base + sysconf(_SC_PAGESIZE);
+  const size_t offset = position % ring.size;
+  const size_t first = std::min(length, ring.size - offset);
+  memcpy(dst, data + offset, first);
+  memcpy((char*)dst + first, data, length - first);
+}
+
+// Consumes the records of a ring, the user space part of each call chain is
+// counted in stacks, leaf first
+static void drain_ring(const ring_t& ring,
+                       std::map<std::vector<uint64_t>, uint64_t>& stacks,
+                       profile_t& profile) {
+  struct perf_event_mmap_page* page = (struct perf_event_mmap_page*)ring.base;
+  const uint64_t head = __atomic_load_n(&page->data_head, __ATOMIC_ACQUIRE);
+  uint64_t tail = page->data_tail;
+
+  std::vector<uint64_t> record;
+  std::vector<uint64_t> stack;
+  while (tail < head) {
+    struct perf_event_header header;
+    copy_ring(ring, tail, &header, sizeof(header));
+    if (header.size < sizeof(header))
+      break;
+
+    record.resize((header.size + 7) / 8);
+    copy_ring(ring, tail, record.data(), header.size);
+    tail += header.size;
+
+    const uint64_t* fields = record.data() + 1;
+    const size_t count = record.size() - 1;
+    if (header.type == PERF_RECORD_LOST && count >= 2) {
+      profile.lost += fields[1];
+      continue;
+    }
+    // ip, pid and tid, nr and the chain
+    if (header.type != PERF_RECORD_SAMPLE || count < 3)
+      continue;
+
+    const uint64_t nr = std::min<uint64_t>(fields[2], count - 3);
+    stack.clear();
+    for (uint64_t i = 0; i < nr; i++) {
+      if (fields[3 + i] < PERF_CONTEXT_MAX)
+        stack.push_back(fields[3 + i]);
+    }
+    if (stack.empty())
+      stack.push_back(fields[0]);
+
+    stacks[stack]++;
+    profile.samples++;
+  }
+
+  __atomic_store_n(&page->data_tail, tail, __ATOMIC_RELEASE);
+}
+
+static int open_sampling(pid_t tid) {
+  struct perf_event_attr attr;
+  memset(&attr, 0, sizeof(attr));
+  attr.size = sizeof(attr);
+  // The CPU clock works in virtual machines and without privileges, unlike
+  // the hardware cycles
+  attr.type = PERF_TYPE_SOFTWARE;
+  attr.config = PERF_COUNT_SW_CPU_CLOCK;
+  attr.freq = 1;
+  attr.sample_freq = SAMPLE_FREQUENCY;
+  attr.sample_type = PERF_SAMPLE_IP | PERF_SAMPLE_TID | PERF_SAMPLE_CALLCHAIN;
+  attr.disabled = 1;
+  // Required by perf_event_paranoid 2
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  attr.exclude_callchain_kernel = 1;
+  attr.watermark = 1;
+  attr.wakeup_watermark = RING_PAGES * sysconf(_SC_PAGESIZE) / 2;
+
+  return (int)syscall(__NR_perf_event_open, &attr, tid, -1, -1,
+                      PERF_FLAG_FD_CLOEXEC);
+}
+
+bool Profiler::run(pid_t pid, float seconds, profile_t& profile) {
+  const std::chrono::steady_clock::time_point started =
+      std::chrono::steady_clock::now();
+
+  // The rings of per thread events cannot be shared, each thread has its
+  // own. Threads created afterwards are not sampled.
+  std::vector<ring_t> rings;
+  const size_t page_size = sysconf(_SC_PAGESIZE);
+  int error = 0;
+  const std::string task = "/proc/" + std::to_string(pid) + "/task";
+  if (DIR* dir = opendir(task.c_str())) {
+    while (struct dirent* entry = readdir(dir)) {
+      const pid_t tid = atoi(entry->d_name);
+      if (tid <= 0 || rings.size() >= MAX_THREADS)
+        continue;
+
+      const int fd = open_sampling(tid);
+      if (fd < 0) {
+        error = errno;
+        continue;
+      }
+
+      void* base = mmap(nullptr, (RING_PAGES + 1) * page_size,
+                        PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+      if (base == MAP_FAILED) {
+        error = errno;
+        close(fd);
+        continue;
+      }
+      rings.push_back(ring_t{fd, (char*)base, RING_PAGES * page_size});
+    }
+    closedir(dir);
+  } else {
+    error = errno;
+  }
+
+  if (rings.empty()) {
+    profile.error = strerror(error);
+    if (error == EACCES || error == EPERM)
+      profile.error += " (see /proc/sys/kernel/perf_event_paranoid)";
+    return true;
+  }
+  profile.threads = rings.size();
+
+  // Loaded before sampling in case the process exits meanwhile
+  std::vector<mapping_t> maps = read_maps(pid);
+
+  for (const ring_t& ring : rings)
+    ioctl(ring.fd, PERF_EVENT_IOC_ENABLE, 0);
+
+  std::map<std::vector<uint64_t>, uint64_t> stacks;
+  std::vector<struct pollfd> fds;
+  for (const ring_t& ring : rings)
+    fds.push_back(pollfd{ring.fd, POLLIN, 0});
+  fds.push_back(pollfd{m_wake, POLLIN, 0});
+
+  const std::chrono::steady_clock::time_point deadline =
+      started + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                    std::chrono::duration<float>(seconds));
+  bool aborted = false;
+  for (;;) {
+    const std::chrono::steady_clock::time_point now =
+        std::chrono::steady_clock::now();
+    if (now >= deadline)
+      break;
+
+    const int timeout =
+        std::chrono::duration_cast<std::chrono::milliseconds>(deadline - now)
+            .count() +
+        1;
+    if (poll(fds.data(), fds.size(), timeout) < 0 && errno != EINTR)
+      break;
+    if (fds.back().revents) {
+      aborted = true;
+      break;
+    }
+
+    for (size_t i = 0; i < rings.size(); i++) {
+      if (fds[i].revents & POLLIN)
+        drain_ring(rings[i], stacks, profile);
+      else if (fds[i].revents & (POLLHUP | POLLERR))
+        fds[i].fd = -1; // The thread exited
+    }
+  }
+
+  for (const ring_t& ring : rings) {
+    ioctl(ring.fd, PERF_EVENT_IOC_DISABLE, 0);
+    drain_ring(ring, stacks, profile);
+    munmap(ring.base, ring.size + page_size);
+    close(ring.fd);
+  }
+
+  if (aborted)
+    return false;
+
+  profile.duration = std::chrono::duration<float>(
+                         std::chrono::steady_clock::now() - started)
+                         .count();
+
+  // Libraries loaded while sampling
+  std::vector<mapping_t> late = read_maps(pid);
+  if (!late.empty())
+    maps = std::move(late);
+
+  // Symbolization, the return addresses of the callers are moved back into
+  // the call instruction
+  std::unordered_map<uint64_t, std::string> names;
+  auto symbolize = [&](uint64_t address) -> const std::string& {
+    auto it = names.find(address);
+    if (it != names.end())
+      return it->second;
+
+    std::string& name = names[address];
+    const mapping_t* mapping = find_mapping(maps, address);
+    if (!mapping) {
+      name = "[unknown]";
+      return name;
+    }
+
+    const std::shared_ptr<elf_image_t> elf =
+        this->image(pid, mapping->path, mapping->key);
+    const uint64_t offset = address - mapping->start + mapping->offset;
+    if (elf) {
+      for (const elf_image_t::segment_t& segment : elf->segments) {
+        if (offset < segment.offset || offset >= segment.offset + segment.size)
+          continue;
+
+        const uint64_t vaddr = offset - segment.offset + segment.vaddr;
+        auto symbol = std::upper_bound(
+            elf->symbols.begin(), elf->symbols.end(), vaddr,
+            [](uint64_t vaddr, const elf_image_t::symbol_t& s) {
+              return vaddr < s.address;
+            });
+        if (symbol == elf->symbols.begin())
+          break;
+        --symbol;
+        if (symbol->size != 0 && vaddr >= symbol->address + symbol->size)
+          break;
+
+        const char* mangled = elf->strings.c_str() + symbol->name;
+        int status = 0;
+        char* demangled =
+            abi::__cxa_demangle(mangled, nullptr, nullptr, &status);
+        name = status == 0 && demangled ? demangled : mangled;
+        free(demangled);
+        return name;
+      }
+    }
+
+    // Without symbols, at least tell the binary
+    name = "[" + mapping->path.substr(mapping->path.rfind('/') + 1) + "]";
+    return name;
+  };
+
+  struct node_t {
+    std::string name;
+    int parent;
+    int depth;
+    uint64_t value;
+    std::map<std::string, int> children;
+  };
+  std::vector<node_t> tree(1);
+  tree[0] = node_t{"all", -1, 0, 0, {}};
+
+  std::unordered_map<std::string, profile_function_t> functions;
+  std::vector<const std::string*> frames;
+  std::unordered_set<const profile_function_t*> seen;
+  for (const auto& stack : stacks) {
+    frames.clear();
+    for (size_t i = 0; i < stack.first.size(); i++) {
+      const uint64_t address = stack.first[i];
+      frames.push_back(&symbolize(i == 0 ? address : address - 1));
+    }
+
+    profile_function_t& leaf = functions[*frames[0]];
+    leaf.self += stack.second;
+
+    // Recursive functions are only counted once per stack
+    seen.clear();
+    for (const std::string* frame : frames) {
+      profile_function_t& function = functions[*frame];
+      if (seen.insert(&function).second)
+        function.total += stack.second;
+    }
+
+    int node = 0;
+    tree[0].value += stack.second;
+    for (auto frame = frames.rbegin(); frame != frames.rend(); ++frame) {
+      auto child = tree[node].children.find(**frame);
+      if (child == tree[node].children.end()) {
+        tree.push_back(node_t{**frame, node, tree[node].depth + 1, 0, {}});
+        child = tree[node].children.emplace(**frame, tree.size() - 1).first;
+      }
+      node = child->second;
+      tree[node].value += stack.second;
+    }
+  }
+
+  for (auto& function : functions) {
+    function.second.name = function.first;
+    profile.functions.push_back(std::move(function.second));
+  }
+  std::sort(profile.functions.begin(), profile.functions.end(),
+            [](const profile_function_t& a, const profile_function_t& b) {
+              return a.self != b.self ? a.self > b.self : a.total > b.total;
+            });
+
+  // Depth first, the children by name as in the usual flame graphs
+  std::vector<std::pair<int, int>> pending = {{0, -1}};
+  while (!pending.empty()) {
+    const int node = pending.back().first;
+    const int parent = pending.back().second;
+    pending.pop_back();
+
+    const int index = profile.flame.size();
+    profile.flame.push_back(profile_node_t{tree[node].name, parent,
+                                           tree[node].depth, tree[node].value});
+    for (auto child = tree[node].children.rbegin();
+         child != tree[node].children.rend(); ++child)
+      pending.push_back({child->second, index});
+  }
+
+  return true;
+}
+
+std::shared_ptr<elf_image_t> Profiler::image(pid_t pid, const std::string& path,
+                                             const std::string& key) {
+  auto it = m_images.find(key);
+  if (it != m_images.end())
+    return it->second;
+
+  if (m_images.size() >= MAX_IMAGES)
+    m_images.clear();
+
+  // Through the root of the process first, in case it lives in another mount
+  // namespace
+  std::shared_ptr<elf_image_t> image(new elf_image_t());
+  if (!load_image("/proc/" + std::to_string(pid) + "/root" + path, *image) &&
+      !load_image(path, *image))
+    image.reset();
+
+  m_images[key] = image;
+  return image;
+}
+
+// count entries of entsize bytes at offset lie within the file, written so
+// that offsets of a malformed ELF cannot wrap around
+static bool in_file(uint64_t offset, uint64_t count, size_t entsize,
+                    size_t size) {
+  return offset <= size && count <= (size - offset) / entsize;
+}
+
+static bool load_image(const std::string& path, elf_image_t& image) {
+  const int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0)
+    return false;
+
+  struct stat st;
+  if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(Elf64_Ehdr)) {
+    close(fd);
+    return false;
+  }
+
+  const size_t size = st.st_size;
+  void* map = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED)
+    return false;
+
+  const char* data = (const char*)map;
+  const Elf64_Ehdr* ehdr = (const Elf64_Ehdr*)data;
+  bool valid = memcmp(ehdr->e_ident, ELFMAG, SELFMAG) == 0 &&
+               ehdr->e_ident[EI_CLASS] == ELFCLASS64 &&
+               in_file(ehdr->e_phoff, ehdr->e_phnum, sizeof(Elf64_Phdr),
+                       size) &&
+               in_file(ehdr->e_shoff, ehdr->e_shnum, sizeof(Elf64_Shdr), size);
+
+  if (valid) {
+    const Elf64_Phdr* phdrs = (const Elf64_Phdr*)(data + ehdr->e_phoff);
+    for (int i = 0; i < ehdr->e_phnum; i++) {
+      if (phdrs[i].p_type == PT_LOAD)
+        image.segments.push_back(elf_image_t::segment_t{
+            phdrs[i].p_offset, phdrs[i].p_vaddr, phdrs[i].p_filesz});
+    }
+
+    const Elf64_Shdr* shdrs = (const Elf64_Shdr*)(data + ehdr->e_shoff);
+    const Elf64_Shdr* symtab = nullptr;
+    for (int i = 0; i < ehdr->e_shnum; i++) {
+      if (shdrs[i].sh_type == SHT_SYMTAB ||
+          (shdrs[i].sh_type == SHT_DYNSYM && !symtab))
+        symtab = &shdrs[i];
+    }
+
+    if (symtab && symtab->sh_link < ehdr->e_shnum &&
+        in_file(symtab->sh_offset, symtab->sh_size, 1, size)) {
+      const Elf64_Shdr& strtab = shdrs[symtab->sh_link];
+      if (in_file(strtab.sh_offset, strtab.sh_size, 1, size) &&
+          strtab.sh_size > 0) {
+        image.strings.assign(data + strtab.sh_offset, strtab.sh_size);
+        image.strings.back() = '\0';
+
+        const Elf64_Sym* symbols = (const Elf64_Sym*)(data + symtab->sh_offset);
+        const size_t count = symtab->sh_size / sizeof(Elf64_Sym);
+        for (size_t i = 0; i < count; i++) {
+          const int type = ELF64_ST_TYPE(symbols[i].st_info);
+          if ((type != STT_FUNC && type != STT_GNU_IFUNC) ||
+              symbols[i].st_value == 0 || symbols[i].st_shndx == SHN_UNDEF ||
+              symbols[i].st_name >= image.strings.size())
+            continue;
+          image.symbols.push_back(elf_image_t::symbol_t{
+              symbols[i].st_value, symbols[i].st_size, symbols[i].st_name});
+        }
+        std::sort(image.symbols.begin(), image.symbols.end(),
+                  [](const elf_image_t::symbol_t& a,
+                     const elf_image_t::symbol_t& b) {
+                    return a.address < b.address;
+                  });
+      }
+    }
+  }
+
+  munmap(map, size);
+  return valid;
+}
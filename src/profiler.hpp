@@ -0,0 +1,73 @@
+#ifndef __PROFILER_HPP__
+#define __PROFILER_HPP__
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdint.h>
+#include <string>
+#include <sys/types.h>
+#include <thread>
+#include <vector>
+
+struct profile_function_t {
+  std::string name;
+  uint64_t self;  // samples where it was the leaf
+  uint64_t total; // samples where it was on the stack
+};
+
+// Flame graph node, the children of a node follow it in depth first order
+struct profile_node_t {
+  std::string name;
+  int parent; // -1 for the root
+  int depth;
+  uint64_t value; // samples
+};
+
+struct profile_t {
+  pid_t pid;
+  std::string name;
+  float duration; // seconds
+  int threads;
+  uint64_t samples;
+  uint64_t lost;
+  std::string error; // set when the profile could not be started
+
+  std::vector<profile_function_t> functions; // by decreasing self samples
+  std::vector<profile_node_t> flame;         // [0] is the root
+};
+
+struct elf_image_t;
+
+// Samples the user space call stacks of a process with perf_event_open and
+// symbolizes them from the ELF symbol tables of the mapped binaries, all on
+// its own thread. Profiling one's own processes works unprivileged as long
+// as perf_event_paranoid <= 2.
+class Profiler {
+public:
+  Profiler();
+  ~Profiler();
+
+  // done is called from the profiler thread once the profile is ready.
+  // Returns false if a profile is already running.
+  bool start(pid_t pid, const std::string& name, float seconds,
+             std::function<void(profile_t)> done);
+  bool running();
+
+private:
+  bool run(pid_t pid, float seconds, profile_t& profile);
+  std::shared_ptr<elf_image_t> image(pid_t pid, const std::string& path,
+                                     const std::string& key);
+
+  std::mutex m_mutex;
+  std::thread m_thread;
+  bool m_running;
+  int m_wake; // eventfd aborting the profile in progress
+
+  // Symbol tables by device and inode of the binary, only used by the
+  // profiler thread
+  std::map<std::string, std::shared_ptr<elf_image_t>> m_images;
+};
+
+#endif
@@ -0,0 +1,115 @@
+#include "rapl.hpp"
+
+#include <algorithm>
+#include <errno.h>
+#include <fcntl.h>
+#include <filesystem>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <utility>
+
+static bool read_number(int fd, uint64_t& value) {
+  char buffer[32];
+  const ssize_t n = pread(fd, buffer, sizeof(buffer) - 1, 0);
+  if (n <= 0)
+    return false;
+  buffer[n] = '\0';
+
+  char* end;
+  value = strtoull(buffer, &end, 10);
+  return end != buffer;
+}
+
+static std::string read_line(const std::string& path) {
+  char buffer[64];
+  const int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0)
+    return "";
+  const ssize_t n = read(fd, buffer, sizeof(buffer) - 1);
+  close(fd);
+  if (n <= 0)
+    return "";
+  buffer[n] = '\0';
+  buffer[strcspn(buffer, "\n")] = '\0';
+  return buffer;
+}
+
+// (package, subzone), the subzone being -1 for the package itself
+static std::pair<long, long> rapl_zone_key(const std::string& name) {
+  char* end;
+  const long package = strtol(name.c_str() + 11, &end, 10);
+  const long subzone = *end == ':' ? strtol(end + 1, nullptr, 10) : -1;
+  return {package, subzone};
+}
+
+Rapl::Rapl(const std::string& root) : m_error(0) {
+  // "intel-rapl:<package>" and "intel-rapl:<package>:<subzone>", also used
+  // by AMD. The MMIO interface duplicates the package zones and is skipped.
+  std::vector<std::string> names;
+  std::error_code ec;
+  for (const auto& entry : std::filesystem::directory_iterator(root, ec)) {
+    const std::string name = entry.path().filename().string();
+    if (name.compare(0, 11, "intel-rapl:") == 0)
+      names.push_back(name);
+  }
+  // "intel-rapl:0" is followed by its subzones. Sorted on the numbers, as
+  // text "intel-rapl:10" would come before "intel-rapl:1:0".
+  std::sort(names.begin(), names.end(),
+            [](const std::string& a, const std::string& b) {
+              return rapl_zone_key(a) < rapl_zone_key(b);
+            });
+
+  std::string package;
+  for (const std::string& name : names) {
+    const std::string path = root + "/" + name;
+    const std::string label = read_line(path + "/name");
+    const bool subzone = name.find(':', 11) != std::string::npos;
+    if (!subzone)
+      package = label;
+
+    rapl_zone_t zone;
+    zone.name = subzone ? package + "/" + label : label;
+    zone.max_range = 0;
+    const int range =
+        open((path + "/max_energy_range_uj").c_str(), O_RDONLY | O_CLOEXEC);
+    if (range >= 0) {
+      read_number(range, zone.max_range);
+      close(range);
+    }
+
+    zone.fd = open((path + "/energy_uj").c_str(), O_RDONLY | O_CLOEXEC);
+    uint64_t energy;
+    if (zone.fd < 0 || !read_number(zone.fd, energy)) {
+      m_error = zone.fd < 0 ? errno : EIO;
+      if (zone.fd >= 0)
+        close(zone.fd);
+      continue;
+    }
+    m_zones.push_back(zone);
+  }
+}
+
+Rapl::~Rapl() {
+  for (const rapl_zone_t& zone : m_zones)
+    close(zone.fd);
+}
+
+const std::vector<rapl_zone_t>& Rapl::zones() const { return m_zones; }
+
+int Rapl::error() const { return m_error; }
+
+void Rapl::read(std::vector<uint64_t>& energies,
+                std::vector<char>& success) const {
+  energies.resize(m_zones.size());
+  success.resize(m_zones.size());
+  for (size_t i = 0; i < m_zones.size(); i++)
+    success[i] = read_number(m_zones[i].fd, energies[i]);
+}
+
+uint64_t rapl_delta(const rapl_zone_t& zone, uint64_t last, uint64_t now) {
+  if (now >= last)
+    return now - last;
+  // The counter restarts from 0 once it reaches max_energy_range_uj
+  return zone.max_range > last ? zone.max_range - last + now : 0;
+}
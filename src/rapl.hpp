@@ -0,0 +1,35 @@
+#ifndef __RAPL_HPP__
+#define __RAPL_HPP__
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+struct rapl_zone_t {
+  std::string name;   // "package-0", "package-0/dram"...
+  int fd;             // energy_uj, kept open and read with pread()
+  uint64_t max_range; // max_energy_range_uj, where energy_uj wraps around
+};
+
+// The RAPL zones of the powercap class. The energy counters are only readable
+// by root on recent kernels, error() then tells why.
+class Rapl {
+public:
+  Rapl(const std::string& root = "/sys/class/powercap");
+  ~Rapl();
+
+  const std::vector<rapl_zone_t>& zones() const;
+  int error() const;
+
+  // Cumulated energy of each zone in microjoules, success is set per zone
+  void read(std::vector<uint64_t>& energies, std::vector<char>& success) const;
+
+private:
+  std::vector<rapl_zone_t> m_zones;
+  int m_error;
+};
+
+// Energy consumed between two readings of a zone, across a wraparound
+uint64_t rapl_delta(const rapl_zone_t& zone, uint64_t last, uint64_t now);
+
+#endif
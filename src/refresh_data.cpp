@@ -1,21 +1,154 @@
 #include "refresh_data.hpp"
 
-std::shared_ptr<RefreshData> RefreshData::init() {
+#include <thread>
+
+// Slow sensors are read at most once every SENSOR_THROTTLE times their read
+// latency, which keeps each of them under 5% of a worker.
+const float SENSOR_THROTTLE = 20.0f;
+
+// PIDs per shard of the /proc scan
+const size_t SCAN_SHARD = 256;
+
+// smaps_rollup makes the kernel walk the page tables of the process, which
+// takes a while for large ones: they are cached for MEMORY_DETAIL_TTL and
+// read one at a time on a worker.
+const float MEMORY_DETAIL_TTL = 5.0f;
+const size_t MEMORY_DETAIL_TOP = 5;
+
+std::shared_ptr<RefreshData> RefreshData::init(int scan_workers) {
   RefreshData* data = new RefreshData();
   data->graph.animated = true;
   data->graph.fps = 30;
   data->graph.yscale = 100.0;
   data->pid = getpid();
+  data->collectors.cpu_graph = -1;
+  data->profile.seconds = 5.0f;
+  data->interrupts.hide_idle = true;
+  data->collectors.sockets = -1;
+  data->sockets.filter.states = ~0u;
+  data->sockets.filter.tcp = true;
+  data->sockets.filter.udp = true;
 
   data->pages = sysconf(_SC_PHYS_PAGES);
   data->processors = sysconf(_SC_NPROCESSORS_ONLN);
   data->page_size = sysconf(_SC_PAGE_SIZE);
   data->total_memory = data->pages * data->page_size;
 
+  const int workers = std::thread::hardware_concurrency();
+  data->scheduler.reset(new Scheduler(std::max(2, std::min(4, workers))));
+
+  // The collector thread takes part in the scan, the pool only holds the
+  // additional workers.
+  if (scan_workers <= 0)
+    scan_workers = std::max(1, std::min(8, workers / 2));
+  data->scan_workers = scan_workers;
+  if (scan_workers > 1)
+    data->m_scan_pool.reset(new WorkerPool(scan_workers - 1));
+
   return std::shared_ptr<RefreshData>(data);
 }
 
+void RefreshData::start_collectors(float refresh_rate) {
+  // The processes CPU usage is relative to the /proc/stat totals, both are
+  // sampled together to cover the same window.
+  this->scheduler->add("processes", COLLECTOR_EXPENSIVE, refresh_rate, 0.1f,
+                       [this]() {
+                         {
+                           // Frozen while there is a selection
+                           std::lock_guard<std::mutex> lock(this->mutex);
+                           if (this->processes_selection.size() != 0)
+                             return;
+                         }
+                         this->refresh_cpu_stat();
+                         this->refresh_processes();
+                       });
+  this->scheduler->add("memory", COLLECTOR_CHEAP, refresh_rate, 0.1f,
+                       [this]() {
+                         this->refresh_memory();
+                         this->refresh_vmstat();
+                       });
+  this->scheduler->add("memory details", COLLECTOR_CHEAP, 0.5f, 0.25f,
+                       [this]() { this->refresh_memory_details(); });
+  this->scheduler->add("numa", COLLECTOR_CHEAP, refresh_rate, 0.1f,
+                       [this]() { this->refresh_numa(); });
+  this->scheduler->add("perf counters", COLLECTOR_CHEAP, refresh_rate, 0.1f,
+                       [this]() { this->refresh_perf_counters(); });
+  this->scheduler->add("schedstat", COLLECTOR_CHEAP, refresh_rate, 0.1f,
+                       [this]() { this->refresh_schedstat(); });
+  this->scheduler->add("interrupts", COLLECTOR_CHEAP, refresh_rate, 0.1f,
+                       [this]() { this->refresh_interrupts(); });
+  this->scheduler->add("cpu frequency", COLLECTOR_CHEAP, refresh_rate, 0.1f,
+                       [this]() { this->refresh_cpufreq(); });
+  this->scheduler->add("rapl", COLLECTOR_CHEAP, refresh_rate, 0.1f,
+                       [this]() { this->refresh_rapl(); });
+  const int pressure =
+      this->scheduler->add("pressure", COLLECTOR_CHEAP, refresh_rate, 0.1f,
+                           [this]() { this->refresh_pressure(); });
+  this->scheduler->add("network", COLLECTOR_MODERATE, refresh_rate, 0.25f,
+                       [this]() {
+                         this->refresh_interfaces();
+                         this->refresh_net_stats();
+                       });
+  // Hundreds of thousands of sockets on the busy servers
+  const int sockets =
+      this->scheduler->add("sockets", COLLECTOR_EXPENSIVE, refresh_rate, 0.25f,
+                           [this]() { this->refresh_sockets(); });
+  // slabinfo takes the slab mutex of the kernel, no need to hold it often
+  this->scheduler->add("slabinfo", COLLECTOR_MODERATE, 5.0f, 1.0f,
+                       [this]() { this->refresh_slabinfo(); });
+  // Mounts rarely change
+  this->scheduler->add("storages", COLLECTOR_MODERATE, 10.0f, 2.0f,
+                       [this]() { this->refresh_storages(); });
+  this->scheduler->add("cgroups", COLLECTOR_MODERATE, refresh_rate, 0.25f,
+                       [this]() { this->refresh_cgroups(); });
+
+  // Their intervals are set by apply_graph_settings()
+  const int cpu_graph =
+      this->scheduler->add("cpu graph", COLLECTOR_CHEAP, 0.0f, 0.0f,
+                           [this]() { this->refresh_cpu_graph_stat(); });
+  const int sensors =
+      this->scheduler->add("sensors", COLLECTOR_MODERATE, 0.0f, 0.05f,
+                           [this]() { this->refresh_sensors(); });
+
+  // A stall crossing the trigger threshold refreshes the pressure at once
+  this->m_pressure_triggers.reset(
+      new PressureTriggers([this, pressure](pressure_resource_t resource) {
+        {
+          std::lock_guard<std::mutex> lock(this->mutex);
+          this->pressure[resource].triggered++;
+        }
+        this->scheduler->trigger(pressure);
+      }));
+
+  std::lock_guard<std::mutex> lock(this->mutex);
+  this->refresh_rate = refresh_rate;
+  this->collectors.cpu_graph = cpu_graph;
+  this->collectors.sensors = sensors;
+  this->collectors.pressure = pressure;
+  this->collectors.sockets = sockets;
+  for (int i = 0; i < PRESSURE_RESOURCES; i++)
+    this->pressure[i].armed =
+        this->m_pressure_triggers->armed((pressure_resource_t)i);
+  apply_graph_settings();
+}
+
+void RefreshData::apply_graph_settings() {
+  if (this->collectors.cpu_graph < 0)
+    return; // Not started yet
+
+  // The CPU graph is paused when not animated, the sensors fall back to the
+  // refresh rate.
+  const float graph = this->graph.animated ? 1.0f / this->graph.fps : 0.0f;
+  const float sensors =
+      this->graph.animated ? 1.0f / this->graph.fps : this->refresh_rate;
+
+  this->scheduler->set_interval(this->collectors.cpu_graph, graph);
+  this->scheduler->set_interval(this->collectors.sensors, sensors);
+  this->sensors_interval = sensors;
+}
+
 void RefreshData::refresh_operating_system() {
+  std::lock_guard<std::mutex> lock(this->mutex);
 #ifdef _WIN32
   this->operating_system = "Windows (32bit)";
 #elif _WIN64
@@ -36,15 +169,19 @@ void RefreshData::refresh_operating_system() {
 void RefreshData::refresh_user() {
   uid_t uid = getuid();
   struct passwd* entry = getpwuid(uid);
-  if (entry)
-    this->user = std::string(entry->pw_name);
-  else
-    this->user = std::string("<could not get user>");
+  const std::string user =
+      entry ? std::string(entry->pw_name) : "<could not get user>";
+
+  std::lock_guard<std::mutex> lock(this->mutex);
+  this->user = user;
 }
 
 void RefreshData::refresh_hostname() {
   char hostname[HOST_NAME_MAX];
-  if (gethostname(hostname, HOST_NAME_MAX) == 0)
+  const bool success = gethostname(hostname, HOST_NAME_MAX) == 0;
+
+  std::lock_guard<std::mutex> lock(this->mutex);
+  if (success)
     this->hostname = std::string(hostname);
   else
     this->hostname = std::string("<could not get hostname>");
@@ -70,78 +207,190 @@ void RefreshData::refresh_cpu_info() {
       memcpy(CPUBrandString + 32, CPUInfo, sizeof(CPUInfo));
   }
 
+  std::lock_guard<std::mutex> lock(this->mutex);
   this->cpu_info = std::string(CPUBrandString);
 }
 
-bool RefreshData::setup_refresh_battery(const char* procfile_now,
-                                        const char* procfile_full,
-                                        const char* procfile_status) {
-  this->m_if_battery_now = std::ifstream(procfile_now);
-  this->m_if_battery_full = std::ifstream(procfile_full);
-  this->m_if_battery_status = std::ifstream(procfile_status);
-  return m_if_battery_now.is_open() && m_if_battery_full.is_open() &&
-         m_if_battery_status.is_open();
-}
-
-void RefreshData::refresh_battery_full() {
-  uint64_t full;
-  this->m_if_battery_full >> full;
-  this->m_if_battery_full.seekg(std::ios::beg);
-
-  this->battery.full = full;
-}
+void RefreshData::setup_sensors() {
+  std::vector<sensor_t> discovered = discover_sensors();
+  const std::string signature = sensors_signature();
+
+  std::lock_guard<std::mutex> lock(this->mutex);
+
+  // Keep the history of the sensors which are still there after a hotplug
+  for (sensor_t& sensor : discovered) {
+    for (const sensor_t& previous : this->sensors) {
+      if (previous.path == sensor.path) {
+        sensor.current = previous.current;
+        sensor.text = previous.text;
+        sensor.values = previous.values;
+        sensor.latency = previous.latency;
+        sensor.interval = previous.interval;
+        sensor.updated = previous.updated;
+        break;
+      }
+    }
+  }
 
-void RefreshData::refresh_battery() {
-  this->m_if_battery_now >> this->battery.now;
-  this->m_if_battery_now.seekg(std::ios::beg);
+  // The reads still in flight are dropped as their indexes are now stale
+  this->sensors = discovered;
+  this->m_sensors_generation++;
+  this->m_sensors_signature = signature;
+  this->m_sensors_checked = std::chrono::steady_clock::now();
+
+  // Prefer the energy counters of the first battery, thermal_zone0 comes
+  // before the hwmon temperatures as it is what the firmware reports.
+  this->m_sensors_primary = {-1, -1, -1, -1, -1};
+  std::string battery;
+  for (size_t i = 0; i < this->sensors.size(); i++) {
+    const sensor_t& sensor = this->sensors[i];
+    const int index = i;
+
+    if (sensor.source == "power_supply") {
+      if (battery.empty() &&
+          (sensor.label == "energy_now" || sensor.label == "charge_now"))
+        battery = sensor.device;
+    } else if (sensor.kind == SENSOR_TEMPERATURE) {
+      if (this->m_sensors_primary.thermal < 0 ||
+          (sensor.source == "thermal" && sensor.device == "thermal_zone0"))
+        this->m_sensors_primary.thermal = index;
+    } else if (sensor.kind == SENSOR_FAN) {
+      if (this->m_sensors_primary.fan < 0)
+        this->m_sensors_primary.fan = index;
+    }
+  }
 
-  this->m_if_battery_status >> this->battery.status;
-  this->m_if_battery_status.seekg(std::ios::beg);
+  for (size_t i = 0; i < this->sensors.size(); i++) {
+    const sensor_t& sensor = this->sensors[i];
+    if (battery.empty() || sensor.device != battery)
+      continue;
+
+    if (sensor.label == "energy_now" || sensor.label == "charge_now")
+      this->m_sensors_primary.battery_now = i;
+    else if (sensor.label == "energy_full" || sensor.label == "charge_full")
+      this->m_sensors_primary.battery_full = i;
+    else if (sensor.label == "status")
+      this->m_sensors_primary.battery_status = i;
+  }
 
-  std::rotate(this->battery.values.begin(), this->battery.values.begin() + 1,
-              this->battery.values.end());
-  this->battery.values.back() =
-      100.00f * ((float)this->battery.now / (float)this->battery.full);
+  this->battery.present = this->m_sensors_primary.battery_now >= 0 &&
+                          this->m_sensors_primary.battery_full >= 0;
+  this->battery.unit =
+      this->battery.present
+          ? this->sensors[this->m_sensors_primary.battery_now].unit
+          : "";
+  this->thermal.present = this->m_sensors_primary.thermal >= 0;
+  this->fan.present = this->m_sensors_primary.fan >= 0;
 }
 
-bool RefreshData::setup_refresh_thermal(const char* procfile) {
-  this->m_if_thermal = std::ifstream(procfile);
-  return m_if_thermal.is_open();
-}
+void RefreshData::refresh_sensors() {
+  // Look for hotplugged devices once per second, the signature only lists
+  // the class directories and the discovery only runs when it changes.
+  const auto now = std::chrono::steady_clock::now();
+  if (now - this->m_sensors_checked >= std::chrono::seconds(1)) {
+    this->m_sensors_checked = now;
+    if (sensors_signature() != this->m_sensors_signature)
+      setup_sensors();
+  }
 
-void RefreshData::refresh_thermal() {
-  uint64_t current;
-  this->m_if_thermal >> current;
-  this->m_if_thermal.seekg(std::ios::beg);
+  // The reads are asynchronous, a slow sensor never delays the others
+  std::lock_guard<std::mutex> lock(this->mutex);
+  for (size_t i = 0; i < this->sensors.size(); i++) {
+    sensor_t& sensor = this->sensors[i];
+    if (sensor.pending || now < sensor.next)
+      continue;
 
-  std::rotate(this->thermal.values.begin(), this->thermal.values.begin() + 1,
-              this->thermal.values.end());
+    sensor.pending = true;
+    read_sensor_async(i);
+  }
 
-  this->thermal.current = current / 1000;
-  this->thermal.values.back() = this->thermal.current;
+  update_sensors_summary();
 }
 
-bool RefreshData::setup_refresh_fan(const char* procfile) {
-  this->m_if_fan = std::ifstream(procfile);
-  return m_if_fan.is_open();
+void RefreshData::read_sensor_async(size_t index) {
+  const uint64_t generation = this->m_sensors_generation;
+  const std::shared_ptr<sensor_file_t> file = this->sensors[index].file;
+
+  this->scheduler->submit([this, generation, index, file]() {
+    float value = 0.0f;
+    std::string text;
+
+    const auto begin = std::chrono::steady_clock::now();
+    const bool success = read_sensor(*file, value, text);
+    const auto end = std::chrono::steady_clock::now();
+    const float latency =
+        std::chrono::duration<float, std::milli>(end - begin).count();
+
+    std::lock_guard<std::mutex> lock(this->mutex);
+    if (generation != this->m_sensors_generation)
+      return;
+
+    sensor_t& sensor = this->sensors[index];
+    sensor.pending = false;
+    sensor.latency = sensor.latency == 0.0f
+                         ? latency
+                         : 0.8f * sensor.latency + 0.2f * latency;
+    sensor.interval = std::max(this->sensors_interval,
+                               sensor.latency * SENSOR_THROTTLE / 1000.0f);
+    sensor.next = end + std::chrono::duration_cast<std::chrono::nanoseconds>(
+                            std::chrono::duration<float>(sensor.interval));
+
+    if (!success)
+      return;
+
+    sensor.current = value;
+    sensor.text = text;
+    sensor.updated = end;
+    std::rotate(sensor.values.begin(), sensor.values.begin() + 1,
+                sensor.values.end());
+    sensor.values.back() = sensor.current;
+  });
 }
 
-void RefreshData::refresh_fan() {
-  uint64_t current;
-  this->m_if_fan >> current;
-  this->m_if_fan.seekg(std::ios::beg);
+void RefreshData::update_sensors_summary() {
+  if (this->battery.present) {
+    this->battery.now =
+        this->sensors[this->m_sensors_primary.battery_now].current;
+    this->battery.full =
+        this->sensors[this->m_sensors_primary.battery_full].current;
+    if (this->m_sensors_primary.battery_status >= 0)
+      this->battery.status =
+          this->sensors[this->m_sensors_primary.battery_status].text;
+
+    std::rotate(this->battery.values.begin(),
+                this->battery.values.begin() + 1, this->battery.values.end());
+    this->battery.values.back() =
+        this->battery.full > 0.0f
+            ? 100.00f * (this->battery.now / this->battery.full)
+            : 0.0f;
+  }
 
-  std::rotate(this->fan.values.begin(), this->fan.values.begin() + 1,
-              this->fan.values.end());
+  if (this->thermal.present) {
+    std::rotate(this->thermal.values.begin(),
+                this->thermal.values.begin() + 1, this->thermal.values.end());
 
-  this->fan.current = current / 1000;
-  this->fan.values.back() = this->fan.current;
+    this->thermal.current =
+        this->sensors[this->m_sensors_primary.thermal].current;
+    this->thermal.values.back() = this->thermal.current;
+  }
+
+  if (this->fan.present) {
+    std::rotate(this->fan.values.begin(), this->fan.values.begin() + 1,
+                this->fan.values.end());
+
+    this->fan.current = this->sensors[this->m_sensors_primary.fan].current;
+    this->fan.values.back() = this->fan.current;
+  }
 }
 
 bool RefreshData::setup_proc() {
   m_if_proc_stat = std::ifstream("/proc/stat");
+  m_if_proc_stat_graph = std::ifstream("/proc/stat");
   m_if_proc_meminfo = std::ifstream("/proc/meminfo");
-  return m_if_proc_stat.is_open() && m_if_proc_meminfo.is_open();
+  // Optional, the memory activity graphs are hidden without it
+  m_if_proc_vmstat = std::ifstream("/proc/vmstat");
+  return m_if_proc_stat.is_open() && m_if_proc_stat_graph.is_open() &&
+         m_if_proc_meminfo.is_open();
 }
 
 float cpu_diff(const cpu_stat_t& info1, const cpu_stat_t& info2, bool percent) {
@@ -157,19 +406,44 @@ float cpu_diff(const cpu_stat_t& info1, const cpu_stat_t& info2, bool percent) {
          (percent ? 100 : 0);
 }
 
+// Reads the per-core lines which follow the aggregated one
+static std::vector<cpu_stat_t> read_cpu_cores(std::istream& is) {
+  std::vector<cpu_stat_t> cores;
+  std::string line;
+  std::getline(is, line);
+  while (std::getline(is, line) && line.rfind("cpu", 0) == 0) {
+    cpu_stat_t core;
+    std::string _name;
+    std::istringstream iss(line);
+    iss >> _name >> core.user >> core.nice >> core.System >> core.idle >>
+        core.iowait >> core.irq >> core.softirq >> core.steal >>
+        core.guest >> core.guest_nice;
+    core.total = core.user + core.nice + core.System + core.idle +
+                 core.iowait + core.irq + core.softirq + core.steal +
+                 core.guest + core.guest_nice;
+    cores.push_back(core);
+  }
+
+  return cores;
+}
+
 void RefreshData::refresh_cpu_graph_stat(bool initial) {
   cpu_stat_t info;
   std::string _name;
 
-  m_if_proc_stat >> _name >> info.user >> info.nice >> info.System >>
+  m_if_proc_stat_graph >> _name >> info.user >> info.nice >> info.System >>
       info.idle >> info.iowait >> info.irq >> info.softirq >> info.steal >>
       info.guest >> info.guest_nice;
-  this->m_if_proc_stat.seekg(std::ios::beg);
 
   info.total = info.user + info.nice + info.System + info.idle + info.iowait +
                info.irq + info.softirq + info.steal + info.guest +
                info.guest_nice;
 
+  const std::vector<cpu_stat_t> cores = read_cpu_cores(m_if_proc_stat_graph);
+  this->m_if_proc_stat_graph.clear();
+  this->m_if_proc_stat_graph.seekg(std::ios::beg);
+
+  std::lock_guard<std::mutex> lock(this->mutex);
   const float cpu_usage =
       cpu_diff(this->cpu_graph.last, this->cpu_graph.current, true);
   std::rotate(this->cpu_graph.values.begin(),
@@ -182,6 +456,29 @@ void RefreshData::refresh_cpu_graph_stat(bool initial) {
     this->cpu_graph.last = this->cpu_graph.current;
     this->cpu_graph.current = info;
   }
+
+  update_cpu_cores(cores);
+}
+
+void RefreshData::update_cpu_cores(const std::vector<cpu_stat_t>& cores) {
+  if (this->cpu_cores.last.size() != cores.size()) {
+    this->cpu_cores.last = cores;
+    this->cpu_cores.usage.assign(cores.size(), 0.0f);
+    return;
+  }
+
+  for (size_t i = 0; i < cores.size(); i++) {
+    // At high graph FPS a core may not have accumulated a single tick yet,
+    // keep its previous value until it does.
+    if (cores[i].total == this->cpu_cores.last[i].total)
+      continue;
+
+    this->cpu_cores.usage[i] =
+        cpu_diff(this->cpu_cores.last[i], cores[i], true);
+    this->cpu_cores.last[i] = cores[i];
+  }
+
+  this->cpu_cores.generation++;
 }
 
 void RefreshData::refresh_cpu_stat(bool initial) {
@@ -197,6 +494,7 @@ void RefreshData::refresh_cpu_stat(bool initial) {
                info.irq + info.softirq + info.steal + info.guest +
                info.guest_nice;
 
+  std::lock_guard<std::mutex> lock(this->mutex);
   if (initial) {
     this->cpu.last = info;
   } else {
@@ -205,6 +503,309 @@ void RefreshData::refresh_cpu_stat(bool initial) {
   }
 }
 
+void RefreshData::setup_perf_counters() {
+  this->m_perf_counters.reset(new PerfCounters(this->processors));
+  this->m_perf_counters->read(this->m_perf_last);
+  this->m_perf_updated = std::chrono::steady_clock::now();
+
+  std::lock_guard<std::mutex> lock(this->mutex);
+  this->perf.mode = this->m_perf_counters->mode();
+  this->perf.error = this->m_perf_counters->error();
+}
+
+static float perf_ratio(const perf_values_t& now, const perf_values_t& last,
+                        perf_counter_t numerator, perf_counter_t denominator,
+                        float scale) {
+  // A group may not have been scheduled, and the scaled values of a
+  // multiplexed one are estimates which can go backwards
+  if (!now.present[numerator] || !now.present[denominator] ||
+      !last.present[numerator] || !last.present[denominator] ||
+      now.values[numerator] < last.values[numerator] ||
+      now.values[denominator] <= last.values[denominator])
+    return 0.0f;
+  const uint64_t d = now.values[denominator] - last.values[denominator];
+  return scale * (now.values[numerator] - last.values[numerator]) / d;
+}
+
+// Per second, with the same checks as perf_ratio
+static float perf_rate(const perf_values_t& now, const perf_values_t& last,
+                       perf_counter_t counter, float seconds) {
+  if (!now.present[counter] || !last.present[counter] ||
+      now.values[counter] < last.values[counter] || seconds <= 0.0f)
+    return 0.0f;
+  return (now.values[counter] - last.values[counter]) / seconds;
+}
+
+void RefreshData::refresh_perf_counters() {
+  if (!this->m_perf_counters ||
+      this->m_perf_counters->mode() == PERF_UNAVAILABLE)
+    return;
+
+  std::vector<perf_values_t> values;
+  this->m_perf_counters->read(values);
+
+  const auto now = std::chrono::steady_clock::now();
+  const float seconds =
+      std::chrono::duration<float>(now - this->m_perf_updated).count();
+  this->m_perf_updated = now;
+
+  std::vector<perf_core_t> cores(values.size());
+  std::array<float, 4> averages = {};
+  for (size_t i = 0; i < values.size() && i < this->m_perf_last.size(); i++) {
+    const perf_values_t& v = values[i];
+    const perf_values_t& l = this->m_perf_last[i];
+    perf_core_t& core = cores[i];
+
+    core.ipc = perf_ratio(v, l, PERF_INSTRUCTIONS, PERF_CYCLES, 1.0f);
+    core.cache_miss =
+        perf_ratio(v, l, PERF_CACHE_MISSES, PERF_CACHE_REFERENCES, 100.0f);
+    core.branch_miss =
+        perf_ratio(v, l, PERF_BRANCH_MISSES, PERF_BRANCHES, 100.0f);
+    core.stalled =
+        perf_ratio(v, l, PERF_STALLED_FRONTEND, PERF_STALL_CYCLES, 100.0f) +
+        perf_ratio(v, l, PERF_STALLED_BACKEND, PERF_STALL_CYCLES, 100.0f);
+
+    core.context_switches = perf_rate(v, l, PERF_CONTEXT_SWITCHES, seconds);
+    core.page_faults = perf_rate(v, l, PERF_PAGE_FAULTS, seconds);
+    core.migrations = perf_rate(v, l, PERF_CPU_MIGRATIONS, seconds);
+
+    if (this->m_perf_counters->mode() == PERF_HARDWARE) {
+      averages[0] += core.ipc;
+      averages[1] += core.cache_miss;
+      averages[2] += core.branch_miss;
+      averages[3] += core.stalled;
+    } else {
+      averages[0] += core.context_switches;
+      averages[1] += core.page_faults;
+      averages[2] += core.migrations;
+    }
+  }
+  this->m_perf_last = std::move(values);
+
+  std::lock_guard<std::mutex> lock(this->mutex);
+  for (size_t i = 0; i < averages.size(); i++) {
+    std::array<float, 60>& series = this->perf.series[i];
+    std::rotate(series.begin(), series.begin() + 1, series.end());
+    series.back() = cores.empty() ? 0.0f : averages[i] / cores.size();
+  }
+  this->perf.cores = std::move(cores);
+}
+
+// Only the cpu lines are used, the domain ones are skipped
+static std::vector<schedstat_cpu_t> read_schedstat(std::istream& is) {
+  std::vector<schedstat_cpu_t> cpus;
+  std::string line;
+  while (std::getline(is, line)) {
+    schedstat_cpu_t cpu;
+    unsigned long long running, waiting, timeslices;
+    if (sscanf(line.c_str(), "cpu%d %*u %*u %*u %*u %*u %*u %llu %llu %llu",
+               &cpu.cpu, &running, &waiting, &timeslices) != 4)
+      continue;
+    cpu.running = running;
+    cpu.waiting = waiting;
+    cpu.timeslices = timeslices;
+    cpus.push_back(cpu);
+  }
+
+  is.clear();
+  is.seekg(std::ios::beg);
+  return cpus;
+}
+
+void RefreshData::setup_schedstat() {
+  this->m_if_proc_schedstat = std::ifstream("/proc/schedstat");
+  if (!this->m_if_proc_schedstat.is_open())
+    return;
+
+  this->m_schedstat_last = read_schedstat(this->m_if_proc_schedstat);
+  this->m_schedstat_updated = std::chrono::steady_clock::now();
+
+  std::lock_guard<std::mutex> lock(this->mutex);
+  this->run_queues.present = !this->m_schedstat_last.empty();
+}
+
+void RefreshData::refresh_schedstat() {
+  if (this->m_schedstat_last.empty())
+    return;
+
+  const std::vector<schedstat_cpu_t> cpus =
+      read_schedstat(this->m_if_proc_schedstat);
+
+  const auto now = std::chrono::steady_clock::now();
+  const float seconds =
+      std::chrono::duration<float>(now - this->m_schedstat_updated).count();
+  this->m_schedstat_updated = now;
+
+  // CPUs going on or offline change the layout, start over
+  std::vector<run_queue_t> cores;
+  for (size_t i = 0; i < cpus.size(); i++) {
+    if (i >= this->m_schedstat_last.size() ||
+        this->m_schedstat_last[i].cpu != cpus[i].cpu || seconds <= 0.0f) {
+      cores.clear();
+      break;
+    }
+
+    const schedstat_cpu_t& last = this->m_schedstat_last[i];
+    const uint64_t waiting = cpus[i].waiting - last.waiting;
+    const uint64_t timeslices = cpus[i].timeslices - last.timeslices;
+
+    run_queue_t core;
+    core.cpu = cpus[i].cpu;
+    core.running = (cpus[i].running - last.running) / 1e7f / seconds;
+    core.waiting = waiting / 1e6f / seconds;
+    core.timeslices = timeslices / seconds;
+    core.latency = timeslices > 0 ? waiting / 1e3f / timeslices : 0.0f;
+    cores.push_back(core);
+  }
+  this->m_schedstat_last = cpus;
+
+  std::lock_guard<std::mutex> lock(this->mutex);
+  this->run_queues.present = !cpus.empty();
+  this->run_queues.cores = std::move(cores);
+}
+
+void RefreshData::setup_cpufreq() {
+  this->m_cpufreq.reset(new CpuFrequencies());
+  this->m_cpufreq->read(this->m_cpufreq_last);
+  this->m_cpufreq_updated = std::chrono::steady_clock::now();
+
+  float max = 0.0f;
+  for (const cpufreq_sample_t& sample : this->m_cpufreq_last)
+    max = std::max(max, sample.max);
+
+  std::lock_guard<std::mutex> lock(this->mutex);
+  this->cpufreq.frequency = this->m_cpufreq->frequency();
+  this->cpufreq.throttling = this->m_cpufreq->throttling();
+  this->cpufreq.max = max;
+}
+
+void RefreshData::refresh_cpufreq() {
+  if (!this->m_cpufreq ||
+      (!this->m_cpufreq->frequency() && !this->m_cpufreq->throttling()))
+    return;
+
+  std::vector<cpufreq_sample_t> samples;
+  this->m_cpufreq->read(samples);
+
+  const auto now = std::chrono::steady_clock::now();
+  const float seconds =
+      std::chrono::duration<float>(now - this->m_cpufreq_updated).count();
+  this->m_cpufreq_updated = now;
+
+  std::vector<core_frequency_t> cores(samples.size());
+  float frequencies = 0.0f;
+  int counted = 0;
+  float throttles = 0.0f;
+  for (size_t i = 0; i < samples.size(); i++) {
+    const cpufreq_sample_t& sample = samples[i];
+    const cpufreq_sample_t& last = this->m_cpufreq_last[i];
+    core_frequency_t& core = cores[i];
+    core.cpu = sample.cpu;
+    core.frequency = sample.frequency;
+    core.max = sample.max;
+    core.core_throttles = sample.core_throttles;
+    core.package_throttles = sample.package_throttles;
+    if (seconds > 0.0f && sample.core_throttles >= last.core_throttles)
+      core.throttle_rate =
+          (sample.core_throttles - last.core_throttles) / seconds;
+
+    if (sample.has_frequency) {
+      frequencies += sample.frequency;
+      counted++;
+    }
+    throttles += core.throttle_rate;
+  }
+  this->m_cpufreq_last = std::move(samples);
+
+  std::lock_guard<std::mutex> lock(this->mutex);
+  std::rotate(this->cpufreq.values.begin(), this->cpufreq.values.begin() + 1,
+              this->cpufreq.values.end());
+  this->cpufreq.values.back() = counted > 0 ? frequencies / counted : 0.0f;
+  std::rotate(this->cpufreq.throttles.begin(),
+              this->cpufreq.throttles.begin() + 1,
+              this->cpufreq.throttles.end());
+  this->cpufreq.throttles.back() = throttles;
+  this->cpufreq.cores = std::move(cores);
+}
+
+void RefreshData::setup_rapl() {
+  this->m_rapl.reset(new Rapl());
+  std::vector<char> success;
+  this->m_rapl->read(this->m_rapl_last, success);
+  this->m_rapl_updated = std::chrono::steady_clock::now();
+
+  std::lock_guard<std::mutex> lock(this->mutex);
+  this->power.error = this->m_rapl->error();
+  this->power.domains.clear();
+  for (const rapl_zone_t& zone : this->m_rapl->zones()) {
+    power_domain_t domain = {};
+    domain.name = zone.name;
+    this->power.domains.push_back(domain);
+  }
+}
+
+void RefreshData::refresh_rapl() {
+  if (!this->m_rapl || this->m_rapl->zones().empty())
+    return;
+
+  std::vector<uint64_t> energies;
+  std::vector<char> success;
+  this->m_rapl->read(energies, success);
+
+  const auto now = std::chrono::steady_clock::now();
+  const float seconds =
+      std::chrono::duration<float>(now - this->m_rapl_updated).count();
+  this->m_rapl_updated = now;
+
+  const std::vector<rapl_zone_t>& zones = this->m_rapl->zones();
+  std::vector<float> watts(zones.size(), 0.0f);
+  for (size_t i = 0; i < zones.size(); i++) {
+    if (!success[i]) {
+      energies[i] = this->m_rapl_last[i];
+      continue;
+    }
+    if (seconds > 0.0f)
+      watts[i] = rapl_delta(zones[i], this->m_rapl_last[i], energies[i]) /
+                 1e6f / seconds;
+  }
+  this->m_rapl_last = std::move(energies);
+
+  std::lock_guard<std::mutex> lock(this->mutex);
+  for (size_t i = 0; i < watts.size(); i++) {
+    power_domain_t& domain = this->power.domains[i];
+    domain.watts = watts[i];
+    std::rotate(domain.values.begin(), domain.values.begin() + 1,
+                domain.values.end());
+    domain.values.back() = watts[i];
+  }
+}
+
+void RefreshData::setup_interrupts() {
+  this->m_interrupts_hard.reset(new InterruptCounters("/proc/interrupts"));
+  this->m_interrupts_soft.reset(new InterruptCounters("/proc/softirqs"));
+  refresh_interrupts();
+}
+
+void RefreshData::refresh_interrupts() {
+  const auto now = std::chrono::steady_clock::now();
+  const float seconds =
+      std::chrono::duration<float>(now - this->m_interrupts_updated).count();
+  this->m_interrupts_updated = now;
+
+  this->m_interrupts_hard->update(this->m_irq_hard, seconds);
+  this->m_interrupts_soft->update(this->m_irq_soft, seconds);
+
+  // Copy assignments reuse the storage of the published rows
+  std::lock_guard<std::mutex> lock(this->mutex);
+  this->interrupts.cpus = this->m_interrupts_hard->cpus();
+  this->interrupts.cpu_ids = this->m_interrupts_hard->cpu_ids();
+  this->interrupts.hard = this->m_irq_hard;
+  this->interrupts.soft = this->m_irq_soft;
+  this->interrupts.parsed =
+      this->m_interrupts_hard->parsed() + this->m_interrupts_soft->parsed();
+  this->interrupts.generation++;
+}
+
 void RefreshData::refresh_memory() {
   uint64_t MemTotal = 0, MemFree = 0, MemAvailable = 0;
   uint64_t SwapTotal = 0, SwapFree = 0;
@@ -240,6 +841,7 @@ void RefreshData::refresh_memory() {
   const uint64_t buffers = Buffers;
   const uint64_t cache = Cached + SReclaimable;
 
+  std::lock_guard<std::mutex> lock(this->mutex);
   const uint64_t phys_total = MemTotal * 1024;
   const uint64_t phys_used = (MemTotal - MemAvailable) * 1024;
   const float phys_percent = (float)((float)phys_used / (float)phys_total);
@@ -258,14 +860,241 @@ void RefreshData::refresh_memory() {
   this->memory.virt_percent = virt_percent;
 }
 
+static const struct {
+  const char* name;
+  vmstat_counter_t counter;
+} VMSTAT_FIELDS[] = {
+    {"pswpin", VMSTAT_SWAP_IN},
+    {"pswpout", VMSTAT_SWAP_OUT},
+    {"pgmajfault", VMSTAT_MAJOR_FAULTS},
+    {"pgscan_kswapd", VMSTAT_SCANNED},
+    {"pgscan_direct", VMSTAT_SCANNED},
+    {"pgscan_khugepaged", VMSTAT_SCANNED},
+    {"pgscan_proactive", VMSTAT_SCANNED},
+    {"pgsteal_kswapd", VMSTAT_STOLEN},
+    {"pgsteal_direct", VMSTAT_STOLEN},
+    {"pgsteal_khugepaged", VMSTAT_STOLEN},
+    {"pgsteal_proactive", VMSTAT_STOLEN},
+    {"thp_fault_alloc", VMSTAT_THP_ALLOC},
+    {"thp_collapse_alloc", VMSTAT_THP_ALLOC},
+    {"thp_fault_fallback", VMSTAT_THP_FALLBACK},
+    {"nr_dirty", VMSTAT_DIRTY},
+    {"nr_writeback", VMSTAT_WRITEBACK},
+};
+
+// One pass over the file, "<name> <value>" per line
+static bool read_vmstat(std::istream& is,
+                        std::array<uint64_t, VMSTAT_COUNTERS>& counters) {
+  counters.fill(0);
+  bool found = false;
+
+  char name[64];
+  unsigned long long value;
+  std::string line;
+  while (std::getline(is, line)) {
+    if (sscanf(line.c_str(), "%63s %llu", name, &value) != 2)
+      continue;
+    for (const auto& field : VMSTAT_FIELDS) {
+      if (strcmp(name, field.name) == 0) {
+        counters[field.counter] += value;
+        found = true;
+        break;
+      }
+    }
+  }
+
+  is.clear();
+  is.seekg(std::ios::beg);
+  return found;
+}
+
+void RefreshData::refresh_vmstat() {
+  if (!this->m_if_proc_vmstat.is_open())
+    return;
+
+  std::array<uint64_t, VMSTAT_COUNTERS> counters;
+  if (!read_vmstat(this->m_if_proc_vmstat, counters))
+    return;
+
+  const auto now = std::chrono::steady_clock::now();
+  const float seconds =
+      std::chrono::duration<float>(now - this->m_vmstat_updated).count();
+  const bool initial =
+      this->m_vmstat_updated == std::chrono::steady_clock::time_point{};
+  this->m_vmstat_updated = now;
+
+  std::array<float, VMSTAT_COUNTERS> current;
+  for (int i = 0; i < VMSTAT_COUNTERS; i++) {
+    if (i >= VMSTAT_DIRTY)
+      current[i] = counters[i];
+    else if (initial || seconds <= 0.0f || counters[i] < m_vmstat_last[i])
+      current[i] = 0.0f;
+    else
+      current[i] = (counters[i] - this->m_vmstat_last[i]) / seconds;
+  }
+  this->m_vmstat_last = counters;
+
+  std::lock_guard<std::mutex> lock(this->mutex);
+  this->vmstat.present = true;
+  this->vmstat.current = current;
+  for (int i = 0; i < VMSTAT_COUNTERS; i++) {
+    std::array<float, 60>& values = this->vmstat.values[i];
+    std::rotate(values.begin(), values.begin() + 1, values.end());
+    values.back() = current[i];
+  }
+}
+
+// "<name> <active_objs> <num_objs> <objsize> <objperslab> <pagesperslab>
+// : tunables ... : slabdata <active_slabs> <num_slabs> <sharedavail>"
+static bool read_slabinfo(std::vector<slab_cache_t>& caches, long page_size,
+                          int& error) {
+  std::ifstream file("/proc/slabinfo");
+  if (!file.is_open()) {
+    error = errno;
+    return false;
+  }
+
+  std::string line;
+  while (std::getline(file, line)) {
+    char name[64];
+    unsigned long long active, objects, size, pages, slabs;
+    if (sscanf(line.c_str(),
+               "%63s %llu %llu %llu %*u %llu : tunables %*u %*u %*u : "
+               "slabdata %*u %llu",
+               name, &active, &objects, &size, &pages, &slabs) != 6)
+      continue;
+
+    slab_cache_t cache = {};
+    cache.name = name;
+    cache.active_objects = active;
+    cache.objects = objects;
+    cache.active_bytes = active * size;
+    cache.bytes = slabs * pages * page_size;
+    caches.push_back(cache);
+  }
+
+  error = 0;
+  return true;
+}
+
+void RefreshData::refresh_slabinfo() {
+  std::vector<slab_cache_t> caches;
+  int error;
+  if (!read_slabinfo(caches, this->page_size, error)) {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    this->slabs.present = false;
+    this->slabs.error = error;
+    return;
+  }
+
+  const auto now = std::chrono::steady_clock::now();
+  this->m_slab_times.push_back(now);
+  if (this->m_slab_times.size() > 60)
+    this->m_slab_times.pop_front();
+
+  // Only written by this collector, the previous caches are read unlocked
+  std::unordered_map<std::string, const slab_cache_t*> previous;
+  for (const slab_cache_t& cache : this->slabs.caches)
+    previous[cache.name] = &cache;
+
+  uint64_t bytes = 0;
+  for (slab_cache_t& cache : caches) {
+    bytes += cache.bytes;
+
+    const auto it = previous.find(cache.name);
+    if (it != previous.end()) {
+      cache.values = it->second->values;
+      cache.samples = it->second->samples;
+    }
+    std::rotate(cache.values.begin(), cache.values.begin() + 1,
+                cache.values.end());
+    cache.values.back() = cache.bytes;
+    cache.samples = std::min<int>(cache.samples + 1, cache.values.size());
+
+    // From the oldest sample of the cache still in the window
+    const int samples =
+        std::min<int>(cache.samples, this->m_slab_times.size());
+    const float seconds =
+        std::chrono::duration<float>(
+            now - this->m_slab_times[this->m_slab_times.size() - samples])
+            .count();
+    if (seconds > 0.0f)
+      cache.growth =
+          (cache.values.back() - cache.values[cache.values.size() - samples]) /
+          seconds;
+  }
+
+  std::lock_guard<std::mutex> lock(this->mutex);
+  this->slabs.present = true;
+  this->slabs.error = 0;
+  this->slabs.bytes = bytes;
+  this->slabs.window =
+      std::chrono::duration<float>(now - this->m_slab_times.front()).count();
+  this->slabs.caches = std::move(caches);
+}
+
+void RefreshData::setup_pressure() {
+  for (int i = 0; i < PRESSURE_RESOURCES; i++)
+    this->m_if_proc_pressure[i].open(pressure_path((pressure_resource_t)i));
+}
+
+void RefreshData::refresh_pressure() {
+  std::array<pressure_sample_t, PRESSURE_RESOURCES> samples;
+  for (int i = 0; i < PRESSURE_RESOURCES; i++) {
+    std::ifstream& file = this->m_if_proc_pressure[i];
+    samples[i] = pressure_sample_t{};
+    if (!file.is_open())
+      continue;
+
+    read_pressure(file, samples[i]);
+    file.clear();
+    file.seekg(std::ios::beg);
+  }
+
+  const auto now = std::chrono::steady_clock::now();
+  const float elapsed =
+      std::chrono::duration<float, std::micro>(now - this->m_pressure_updated)
+          .count();
+  const bool first =
+      this->m_pressure_updated == std::chrono::steady_clock::time_point{};
+  this->m_pressure_updated = now;
+
+  std::lock_guard<std::mutex> lock(this->mutex);
+  for (int i = 0; i < PRESSURE_RESOURCES; i++) {
+    pressure_t& pressure = this->pressure[i];
+    const pressure_sample_t& sample = samples[i];
+
+    if (!first && pressure.current.success && sample.success) {
+      pressure.some = std::min(
+          100.0f,
+          (sample.some.total - pressure.current.some.total) * 100 / elapsed);
+      pressure.full = std::min(
+          100.0f,
+          (sample.full.total - pressure.current.full.total) * 100 / elapsed);
+
+      std::rotate(pressure.some_values.begin(),
+                  pressure.some_values.begin() + 1, pressure.some_values.end());
+      pressure.some_values.back() = pressure.some;
+      std::rotate(pressure.full_values.begin(),
+                  pressure.full_values.begin() + 1, pressure.full_values.end());
+      pressure.full_values.back() = pressure.full;
+    }
+
+    pressure.present = sample.success;
+    pressure.current = sample;
+  }
+}
+
 void RefreshData::refresh_storages() {
   std::vector<storage_t> storages;
 
   struct mntent* ent;
   std::vector<std::string> devices;
 
+  // Collectors run on the workers, a missing directory must not throw there
+  std::error_code ec;
   for (std::filesystem::directory_entry entry :
-       std::filesystem::directory_iterator("/dev/disk/by-path/"))
+       std::filesystem::directory_iterator("/dev/disk/by-path/", ec))
     devices.push_back(std::filesystem::is_symlink(entry)
                           ? std::filesystem::read_symlink(entry).filename()
                           : entry);
@@ -296,18 +1125,12 @@ void RefreshData::refresh_storages() {
   std::sort(storages.begin(), storages.end(),
             [](storage_t a, storage_t b) { return a.device < b.device; });
 
+  std::lock_guard<std::mutex> lock(this->mutex);
   this->storages = storages;
 }
 
-pstat_t read_pstat(int pid) {
-  std::ifstream statFile("/proc/" + std::to_string(pid) + "/stat");
+static pstat_t parse_pstat(const std::string& line) {
   pstat_t process_stat;
-
-  if (!statFile.is_open())
-    return pstat_t{};
-
-  std::string line;
-  std::getline(statFile, line);
   std::istringstream iss(line);
 
   iss >> process_stat.pid; // Read PID first
@@ -341,15 +1164,8 @@ pstat_t read_pstat(int pid) {
   return process_stat;
 }
 
-pstatm_t read_pstatm(int pid) {
-  std::ifstream statmFile("/proc/" + std::to_string(pid) + "/statm");
+static pstatm_t parse_pstatm(const std::string& line) {
   pstatm_t process_stat_m;
-
-  if (!statmFile.is_open())
-    return pstatm_t{};
-
-  std::string line;
-  std::getline(statmFile, line);
   std::istringstream iss(line);
 
   iss >> process_stat_m.size >> process_stat_m.resident >>
@@ -363,90 +1179,713 @@ pstatm_t read_pstatm(int pid) {
   return process_stat_m;
 }
 
+// Every thread keeps its own reader, hence its own ring and buffers
+
+static BatchReader& thread_reader() {
+  static thread_local std::unique_ptr<BatchReader> reader;
+  if (!reader)
+    reader.reset(new BatchReader());
+  return *reader;
+}
+
+static pio_t parse_pio(const std::string& text) {
+  pio_t io = {};
+  std::istringstream iss(text);
+  std::string name;
+  uint64_t value;
+  while (iss >> name >> value) {
+    if (name == "rchar:")
+      io.rchar = value;
+    else if (name == "wchar:")
+      io.wchar = value;
+    else if (name == "read_bytes:")
+      io.read_bytes = value;
+    else if (name == "write_bytes:")
+      io.write_bytes = value;
+    else if (name == "cancelled_write_bytes:")
+      io.cancelled_write_bytes = value;
+  }
+  io.success = true;
+  return io;
+}
+
+// schedstat is "<run time> <wait time> <timeslices>", the context switches
+// are near the end of status
+static psched_t parse_psched(const std::string& schedstat,
+                             const std::string& status) {
+  psched_t sched = {};
+  std::istringstream iss(schedstat);
+  if (!(iss >> sched.run_time >> sched.wait_time >> sched.timeslices))
+    return sched;
+
+  const char* fields[] = {"\nvoluntary_ctxt_switches:",
+                          "\nnonvoluntary_ctxt_switches:"};
+  uint64_t* values[] = {&sched.voluntary, &sched.nonvoluntary};
+  for (int i = 0; i < 2; i++) {
+    const size_t at = status.find(fields[i]);
+    if (at == std::string::npos)
+      return sched;
+    *values[i] = strtoull(status.c_str() + at + strlen(fields[i]), NULL, 10);
+  }
+
+  sched.success = true;
+  return sched;
+}
+
+// Reads and parses the stat and statm files of a shard of the PIDs, and
+// their io and scheduler files when requested
+static void scan_processes(const pid_t* pids, size_t count, bool io,
+                           bool sched, std::vector<process_snap_t>& snapshot,
+                           uint64_t& files, uint64_t& syscalls, bool& uring) {
+  BatchReader& reader = thread_reader();
+
+  std::vector<const char*> names = {"/stat", "/statm"};
+  const size_t io_index = names.size();
+  if (io)
+    names.push_back("/io");
+  const size_t sched_index = names.size();
+  if (sched) {
+    names.push_back("/schedstat");
+    names.push_back("/status");
+  }
+  const size_t stride = names.size();
+
+  std::vector<std::string> paths;
+  paths.reserve(stride * count);
+  for (size_t i = 0; i < count; i++) {
+    const std::string directory = "/proc/" + std::to_string(pids[i]);
+    for (const char* name : names)
+      paths.push_back(directory + name);
+  }
+
+  std::vector<std::string> contents;
+  std::vector<char> success;
+  reader.read(paths, contents, success);
+  files = paths.size();
+  syscalls = reader.syscalls();
+  uring = reader.uring();
+
+  snapshot.reserve(count);
+  for (size_t i = 0; i < count; i++) {
+    const size_t base = i * stride;
+
+    // The process may have exited since it was listed
+    if (!success[base] || !success[base + 1])
+      continue;
+
+    pstat_t st = parse_pstat(contents[base]);
+    pstatm_t stm = parse_pstatm(contents[base + 1]);
+
+    process_snap_t p = {};
+    p.pid = st.pid;
+    p.name = st.comm;
+    p.state = st.state;
+    p.pstat = st;
+    p.pstatm = stm;
+    // Only readable for the processes we may ptrace
+    if (io && success[base + io_index])
+      p.io = parse_pio(contents[base + io_index]);
+    if (sched && success[base + sched_index] &&
+        success[base + sched_index + 1])
+      p.sched = parse_psched(contents[base + sched_index],
+                             contents[base + sched_index + 1]);
+
+    snapshot.push_back(std::move(p));
+  }
+}
+
+std::map<pid_t, std::vector<thread_t>>
+RefreshData::refresh_threads(const std::vector<pid_t>& expanded,
+                             float cpu_total) {
+  std::vector<pid_t> owners;
+  std::vector<std::string> paths;
+  for (pid_t pid : expanded) {
+    const std::string task = "/proc/" + std::to_string(pid) + "/task";
+
+    std::error_code error;
+    for (const auto& e : std::filesystem::directory_iterator(task, error)) {
+      owners.push_back(pid);
+      paths.push_back(e.path().string() + "/stat");
+    }
+  }
+
+  std::vector<std::string> contents;
+  std::vector<char> success;
+  thread_reader().read(paths, contents, success);
+
+  std::map<pid_t, std::vector<thread_t>> threads;
+  std::unordered_map<pid_t, unsigned long> times;
+  for (size_t i = 0; i < paths.size(); i++) {
+    if (!success[i])
+      continue;
+
+    const pstat_t st = parse_pstat(contents[i]);
+    const unsigned long cpu_times = st.utime + st.stime;
+    times[st.pid] = cpu_times;
+
+    // A thread seen for the first time has no usage until the next refresh
+    float cpu_usage = 0.0f;
+    const auto last_it = m_thread_times.find(st.pid);
+    if (last_it != m_thread_times.end() && cpu_total > 0.0f)
+      cpu_usage =
+          (processors * (cpu_times - last_it->second) * 100) / cpu_total;
+
+    threads[owners[i]].push_back(
+        thread_t{st.pid, st.comm, st.state, st.processor, cpu_usage});
+  }
+
+  // Collapsed processes and exited threads are forgotten
+  m_thread_times = std::move(times);
+  return threads;
+}
+
 void RefreshData::refresh_processes(bool initial) {
+  std::vector<pid_t> pids;
+  std::vector<pid_t> expanded;
+  bool io, sched;
+  {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    expanded = this->processes_expanded;
+    io = this->processes.io_shown;
+    sched = this->processes.sched_shown;
+  }
+
+  std::error_code error;
+  for (const auto& e : std::filesystem::directory_iterator("/proc", error)) {
+    std::string filename = e.path().filename().string();
+    if (!std::all_of(filename.begin(), filename.end(), ::isdigit))
+      continue;
+
+    pid_t pid = std::atoi(filename.c_str());
+    if (pid != 0)
+      pids.push_back(pid);
+  }
+  const auto now = std::chrono::steady_clock::now();
+
+  // The shards are spread over the scan pool, each one parsed into its own
+  // buffers and concatenated afterwards to keep the order of the listing.
+  const size_t shards = (pids.size() + SCAN_SHARD - 1) / SCAN_SHARD;
+  std::vector<std::vector<process_snap_t>> shard_snapshots(shards);
+  std::vector<uint64_t> shard_files(shards);
+  std::vector<uint64_t> shard_syscalls(shards);
+  std::vector<char> shard_uring(shards);
+
+  const auto scan = [&](size_t shard) {
+    const size_t first = shard * SCAN_SHARD;
+    bool uring = false;
+    scan_processes(pids.data() + first,
+                   std::min(SCAN_SHARD, pids.size() - first), io, sched,
+                   shard_snapshots[shard], shard_files[shard],
+                   shard_syscalls[shard], uring);
+    shard_uring[shard] = uring;
+  };
+
+  if (m_scan_pool)
+    m_scan_pool->parallel_for(shards, scan);
+  else
+    for (size_t shard = 0; shard < shards; shard++)
+      scan(shard);
+
   std::vector<process_snap_t> snapshot;
+  snapshot.reserve(pids.size());
+  uint64_t files = 0;
+  uint64_t syscalls = 0;
+  for (size_t shard = 0; shard < shards; shard++) {
+    std::move(shard_snapshots[shard].begin(), shard_snapshots[shard].end(),
+              std::back_inserter(snapshot));
+    files += shard_files[shard];
+    syscalls += shard_syscalls[shard];
+  }
 
-  for (const auto& e : std::filesystem::directory_iterator(("/proc"))) {
-    std::filesystem::path path = e.path();
-    std::string filename = path.filename().string();
+  const float cpu_total = this->cpu.current.total - this->cpu.last.total;
+  std::map<pid_t, std::vector<thread_t>> threads =
+      refresh_threads(expanded, initial ? 0.0f : cpu_total);
 
-    if (std::all_of(filename.begin(), filename.end(), ::isdigit)) {
-      pid_t pid = std::atoi(filename.c_str());
+  // Only this collector writes the snapshots, they can be read unlocked
+  std::vector<process_t> processes;
+  if (!initial) {
+    std::unordered_map<pid_t, const process_snap_t*> previous;
+    previous.reserve(this->processes.snap_pres.size());
+    for (const process_snap_t& p : this->processes.snap_pres)
+      previous[p.pid] = &p;
+
+    const float seconds =
+        std::chrono::duration<float>(now - this->m_processes_updated).count();
+
+    processes.reserve(snapshot.size());
+    for (const process_snap_t& pres : snapshot) {
+      process_t process = {};
+      process.pid = pres.pid;
+      process.name = pres.name;
+      process.state = pres.state;
+      process.pstat1 = pres.pstat;
+      process.pstatm1 = pres.pstatm;
+
+      float resident = pres.pstat.rss * this->page_size;
+      process.mem = 100 * (resident / this->total_memory);
 
-      if (pid != 0) {
-        std::string stp = "/proc/" + std::to_string(pid) + "/stat";
-        std::string stmp = "/proc/" + std::to_string(pid) + "/statm";
+      // A PID reused by a new process has no history
+      const auto last_process_it = previous.find(pres.pid);
+      if (last_process_it == previous.end() ||
+          last_process_it->second->pstat.starttime != pres.pstat.starttime) {
+        processes.push_back(std::move(process));
+        continue;
+      }
 
-        pstat_t st = read_pstat(pid);
-        pstatm_t stm = read_pstatm(pid);
-        if (!st.success || !stm.success)
-          continue;
+      const process_snap_t& past = *last_process_it->second;
+      process.pstat2 = past.pstat;
+      process.pstatm2 = past.pstatm;
 
-        process_snap_t p = {};
-        p.pid = st.pid;
-        p.name = st.comm;
-        p.state = st.state;
-        p.pstat = st;
-        p.pstatm = stm;
+      uint32_t cpu_times_past = past.pstat.utime + past.pstat.stime;
+      uint32_t cpu_times_pres = pres.pstat.utime + pres.pstat.stime;
 
-        snapshot.push_back(p);
+      process.cpu =
+          (processors * (cpu_times_pres - cpu_times_past) * 100) / cpu_total;
+
+      if (seconds > 0.0f) {
+        process.minflt_rate = (pres.pstat.minflt - past.pstat.minflt) / seconds;
+        process.majflt_rate = (pres.pstat.majflt - past.pstat.majflt) / seconds;
+        process.blkio_rate = (pres.pstat.delayacct_blkio_ticks -
+                              past.pstat.delayacct_blkio_ticks) /
+                             seconds;
+
+        if (pres.io.success && past.io.success) {
+          process.io = true;
+          process.read_rate =
+              (pres.io.read_bytes - past.io.read_bytes) / seconds;
+          process.write_rate =
+              (pres.io.write_bytes - past.io.write_bytes) / seconds;
+        }
+
+        // The times are in nanoseconds, shown as milliseconds per second
+        if (pres.sched.success && past.sched.success) {
+          process.sched = true;
+          process.run_rate =
+              (pres.sched.run_time - past.sched.run_time) / 1e6f / seconds;
+          process.wait_rate =
+              (pres.sched.wait_time - past.sched.wait_time) / 1e6f / seconds;
+          process.timeslices_rate =
+              (pres.sched.timeslices - past.sched.timeslices) / seconds;
+          process.voluntary_rate =
+              (pres.sched.voluntary - past.sched.voluntary) / seconds;
+          process.nonvoluntary_rate =
+              (pres.sched.nonvoluntary - past.sched.nonvoluntary) / seconds;
+        }
       }
+
+      processes.push_back(std::move(process));
     }
   }
 
-  if (initial) {
-    this->processes.snap_past = snapshot;
+  // Kept for the live processes while the scheduler columns are shown, like
+  // the snapshots it is only written by this collector
+  std::unordered_map<pid_t, process_history_t> history;
+  if (sched) {
+    for (const process_t& process : processes) {
+      if (!process.sched)
+        continue;
+
+      process_history_t& h = history[process.pid];
+      const auto last_it = this->processes.history.find(process.pid);
+      if (last_it != this->processes.history.end())
+        h = last_it->second;
+
+      std::rotate(h.wait.begin(), h.wait.begin() + 1, h.wait.end());
+      h.wait.back() = process.wait_rate;
+      std::rotate(h.nonvoluntary.begin(), h.nonvoluntary.begin() + 1,
+                  h.nonvoluntary.end());
+      h.nonvoluntary.back() = process.nonvoluntary_rate;
+    }
+  }
+
+  std::lock_guard<std::mutex> lock(this->mutex);
+  this->processes.files = files;
+  this->processes.syscalls = syscalls;
+  this->processes.uring =
+      std::find(shard_uring.begin(), shard_uring.end(), 1) != shard_uring.end();
+  this->processes.shards = shards;
+  this->processes.threads = std::move(threads);
+  this->processes.history = std::move(history);
+  // Drop the expanded processes which have exited
+  for (pid_t pid : expanded) {
+    if (this->processes.threads.count(pid) == 0)
+      this->processes_expanded.erase(
+          std::remove(this->processes_expanded.begin(),
+                      this->processes_expanded.end(), pid),
+          this->processes_expanded.end());
+  }
+
+  this->m_processes_updated = now;
+  this->processes.snap_past = std::move(this->processes.snap_pres);
+  this->processes.snap_pres = std::move(snapshot);
+  if (!initial)
+    this->processes.processes = std::move(processes);
+}
+
+void RefreshData::setup_cgroups() {
+  const std::string root = cgroup2_root();
+  if (!root.empty())
+    this->m_cgroup_tree.reset(new CgroupTree(root));
+
+  std::lock_guard<std::mutex> lock(this->mutex);
+  this->cgroups.root = root;
+  this->cgroups.inotify = this->m_cgroup_tree && this->m_cgroup_tree->inotify();
+}
+
+void RefreshData::refresh_cgroups() {
+  if (!this->m_cgroup_tree)
     return;
-  } else {
-    this->processes.snap_past = this->processes.snap_pres;
-    this->processes.snap_pres = snapshot;
+
+  std::set<std::string> expanded;
+  {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    expanded = this->cgroups.expanded;
   }
 
-  std::vector<process_t> processes;
-  for (auto pres : this->processes.snap_pres) {
-    const auto last_process_it = std::find_if(
-        this->processes.snap_past.begin(), this->processes.snap_past.end(),
-        [&](const process_snap_t& p) { return p.pid == pres.pid; });
+  // Only the creations and removals since the last refresh are applied
+  this->m_cgroup_tree->update();
+  const std::string& root = this->m_cgroup_tree->root();
 
-    if (last_process_it != this->processes.snap_past.end()) {
-      const auto past = *last_process_it;
+  std::vector<std::string> paths;
+  std::vector<char> procs; // whether cgroup.procs follows the other files
+  for (const std::string& path : this->m_cgroup_tree->paths()) {
+    const std::string directory = path.empty() ? root : root + "/" + path;
+    for (int i = 0; i < CGROUP_FILES; i++)
+      paths.push_back(directory + "/" + cgroup_file_name((cgroup_file_t)i));
 
-      uint32_t cpu_times_past = past.pstat.utime + past.pstat.stime;
-      uint32_t cpu_times_pres = pres.pstat.utime + pres.pstat.stime;
+    procs.push_back(expanded.count(path) != 0);
+    if (procs.back())
+      paths.push_back(directory + "/cgroup.procs");
+  }
 
-      float cpu_usage = (processors * (cpu_times_pres - cpu_times_past) * 100) /
-                        (float)(this->cpu.current.total - this->cpu.last.total);
+  std::vector<std::string> contents;
+  std::vector<char> success;
+  thread_reader().read(paths, contents, success);
+
+  const auto now = std::chrono::steady_clock::now();
+  const float elapsed =
+      std::chrono::duration<float>(now - this->m_cgroups_updated).count();
+  this->m_cgroups_updated = now;
+
+  // The tree is only written by this collector, the previous one is read
+  // unlocked to carry the histories over
+  std::unordered_map<std::string, const cgroup_t*> previous;
+  for (const cgroup_t& cgroup : this->cgroups.tree)
+    previous[cgroup.path] = &cgroup;
+
+  std::vector<cgroup_t> tree;
+  tree.reserve(procs.size());
+  size_t file = 0;
+  size_t index = 0;
+  for (const std::string& path : this->m_cgroup_tree->paths()) {
+    cgroup_t cgroup = {};
+    cgroup.path = path;
+    cgroup.name = path.empty() ? "/" : path.substr(path.rfind('/') + 1);
+    cgroup.depth =
+        path.empty() ? 0 : std::count(path.begin(), path.end(), '/') + 1;
+
+    for (int i = 0; i < CGROUP_FILES; i++, file++) {
+      if (success[file])
+        parse_cgroup_file((cgroup_file_t)i, contents[file], cgroup.stat);
+    }
 
-      float resident = pres.pstat.rss * this->page_size;
-      float mem_usage = 100 * (resident / this->total_memory);
-
-      processes.push_back(process_t{
-          pres.pid,
-          pres.name,
-          pres.state,
-          cpu_usage,
-          mem_usage,
-          pres.pstat,
-          past.pstat,
-          pres.pstatm,
-          past.pstatm,
-      });
-    } else {
-      processes.push_back(process_t{
-          pres.pid,
-          pres.name,
-          pres.state,
-          0.0,
-          0.0,
-          pres.pstat,
-          pstat_t{},
-          pres.pstatm,
-          pstatm_t{},
-      });
+    // Large cgroups overflow the batch buffer, the reader then reads the
+    // file to its end
+    if (procs[index++]) {
+      if (success[file]) {
+        std::istringstream iss(contents[file]);
+        pid_t pid;
+        while (iss >> pid)
+          cgroup.procs.push_back(pid);
+      }
+      file++;
+    }
+
+    // Removed between the listing and the reads
+    if (!cgroup.stat.present[CGROUP_CPU_STAT])
+      continue;
+
+    const auto last_it = previous.find(path);
+    if (last_it != previous.end()) {
+      const cgroup_t& last = *last_it->second;
+      // A cgroup recreated under the same path starts again from zero, and
+      // io.stat drops the devices which went away
+      const auto rate = [elapsed](uint64_t value, uint64_t before) {
+        return value >= before ? (value - before) / elapsed : 0.0f;
+      };
+
+      if (cgroup.stat.usage_usec >= last.stat.usage_usec) {
+        cgroup.cpu_values = last.cpu_values;
+        cgroup.memory_values = last.memory_values;
+
+        if (elapsed > 0.0f) {
+          // Microseconds per second, 1e4 of them make one percent
+          const float throttled =
+              rate(cgroup.stat.throttled_usec, last.stat.throttled_usec);
+          cgroup.cpu =
+              rate(cgroup.stat.usage_usec, last.stat.usage_usec) / 1e4f;
+          cgroup.throttled = std::min(100.0f, throttled / 1e4f);
+          cgroup.read_rate = rate(cgroup.stat.rbytes, last.stat.rbytes);
+          cgroup.write_rate = rate(cgroup.stat.wbytes, last.stat.wbytes);
+        }
+      }
+    }
+
+    std::rotate(cgroup.cpu_values.begin(), cgroup.cpu_values.begin() + 1,
+                cgroup.cpu_values.end());
+    cgroup.cpu_values.back() = cgroup.cpu;
+    std::rotate(cgroup.memory_values.begin(), cgroup.memory_values.begin() + 1,
+                cgroup.memory_values.end());
+    cgroup.memory_values.back() = cgroup.stat.memory_current;
+
+    tree.push_back(std::move(cgroup));
+  }
+
+  std::lock_guard<std::mutex> lock(this->mutex);
+  this->cgroups.tree = std::move(tree);
+}
+
+static bool read_smaps_rollup(pid_t pid, smaps_rollup_t& smaps) {
+  smaps = smaps_rollup_t{};
+  std::ifstream file("/proc/" + std::to_string(pid) + "/smaps_rollup");
+  if (!file.is_open())
+    return false;
+
+  const std::pair<const char*, uint64_t*> fields[] = {
+      {"Rss:", &smaps.rss},
+      {"Pss:", &smaps.pss},
+      {"Pss_Anon:", &smaps.pss_anon},
+      {"Pss_File:", &smaps.pss_file},
+      {"Pss_Shmem:", &smaps.pss_shmem},
+      {"Shared_Clean:", &smaps.shared_clean},
+      {"Shared_Dirty:", &smaps.shared_dirty},
+      {"Private_Clean:", &smaps.private_clean},
+      {"Private_Dirty:", &smaps.private_dirty},
+      {"Anonymous:", &smaps.anonymous},
+      {"Swap:", &smaps.swap},
+      {"SwapPss:", &smaps.swap_pss},
+  };
+
+  bool found = false;
+
+  std::string line;
+  while (std::getline(file, line)) {
+    for (const auto& field : fields) {
+      if (line.rfind(field.first, 0) == std::string::npos)
+        continue;
+
+      std::istringstream iss(line);
+      std::string _name;
+      uint64_t kb = 0;
+      iss >> _name >> kb;
+      *field.second = kb * 1024;
+      found = true;
+      break;
+    }
+  }
+
+  // Empty for kernel threads
+  return found;
+}
+
+void RefreshData::setup_numa() {
+  this->m_numa_nodes = numa_nodes();
+  refresh_numa();
+}
+
+void RefreshData::refresh_numa() {
+  if (this->m_numa_nodes.empty())
+    return;
+
+  std::vector<std::string> paths;
+  for (int node : this->m_numa_nodes) {
+    paths.push_back(numa_node_path(node, "meminfo"));
+    paths.push_back(numa_node_path(node, "numastat"));
+  }
+  std::vector<std::string> contents;
+  std::vector<char> success;
+  thread_reader().read(paths, contents, success);
+
+  std::vector<numa_node_stat_t> stats(this->m_numa_nodes.size());
+  for (size_t i = 0; i < stats.size(); i++) {
+    stats[i].node = this->m_numa_nodes[i];
+    if (success[2 * i])
+      parse_numa_meminfo(contents[2 * i], stats[i]);
+    if (success[2 * i + 1])
+      parse_numastat(contents[2 * i + 1], stats[i]);
+  }
+
+  const auto now = std::chrono::steady_clock::now();
+  const float seconds =
+      std::chrono::duration<float>(now - this->m_numa_updated).count();
+  this->m_numa_updated = now;
+
+  // A counter which failed to read or went backwards gets no rate
+  const auto rate = [seconds](uint64_t value, uint64_t before) {
+    return value >= before ? (value - before) / seconds : 0.0f;
+  };
+
+  // The counters of a node are only known once its numastat was read
+  if (this->m_numa_last.size() != stats.size()) {
+    this->m_numa_last.assign(stats.size(), numa_node_stat_t{});
+    this->m_numa_known.assign(stats.size(), 0);
+  }
+
+  std::vector<numa_node_t> nodes(stats.size());
+  for (size_t i = 0; i < stats.size(); i++) {
+    numa_node_t& node = nodes[i];
+    const numa_node_stat_t& last = this->m_numa_last[i];
+
+    // Keep the last counters rather than zeros when numastat failed
+    if (!success[2 * i + 1]) {
+      stats[i].numa_hit = last.numa_hit;
+      stats[i].numa_miss = last.numa_miss;
+      stats[i].numa_foreign = last.numa_foreign;
+      stats[i].local_node = last.local_node;
+      stats[i].other_node = last.other_node;
+      node.stat = stats[i];
+      continue;
+    }
+
+    node.stat = stats[i];
+    if (this->m_numa_known[i] && seconds > 0.0f) {
+      node.hit_rate = rate(stats[i].numa_hit, last.numa_hit);
+      node.miss_rate = rate(stats[i].numa_miss, last.numa_miss);
+      node.foreign_rate = rate(stats[i].numa_foreign, last.numa_foreign);
+      node.other_rate = rate(stats[i].other_node, last.other_node);
+    }
+    this->m_numa_known[i] = true;
+  }
+  this->m_numa_last = std::move(stats);
+
+  std::lock_guard<std::mutex> lock(this->mutex);
+  this->numa.nodes = std::move(nodes);
+}
+
+void RefreshData::read_numa_maps_async(pid_t pid, const std::string& name) {
+  numa_placement_t& placement = this->numa.placement;
+  if (placement.pending)
+    return;
+
+  placement.pid = pid;
+  placement.name = name;
+  placement.pending = true;
+
+  this->scheduler->submit([this, pid]() {
+    std::map<int, uint64_t> nodes;
+    const auto begin = std::chrono::steady_clock::now();
+    const bool success = read_numa_maps(pid, nodes);
+    const auto end = std::chrono::steady_clock::now();
+
+    std::lock_guard<std::mutex> lock(this->mutex);
+    numa_placement_t& placement = this->numa.placement;
+    placement.pending = false;
+    placement.success = success;
+    placement.nodes = std::move(nodes);
+    placement.latency =
+        std::chrono::duration<float, std::milli>(end - begin).count();
+  });
+}
+
+void RefreshData::refresh_memory_details() {
+  std::lock_guard<std::mutex> lock(this->mutex);
+  if (!this->processes.details_shown)
+    return;
+
+  std::vector<const process_t*> targets;
+  for (const process_t& process : this->processes.processes) {
+    if (std::find(this->processes_selection.begin(),
+                  this->processes_selection.end(),
+                  process.pid) != this->processes_selection.end())
+      targets.push_back(&process);
+  }
+
+  if (this->processes_selection.empty()) {
+    for (const process_t& process : this->processes.processes)
+      targets.push_back(&process);
+
+    const size_t top = std::min(MEMORY_DETAIL_TOP, targets.size());
+    std::partial_sort(targets.begin(), targets.begin() + top, targets.end(),
+                      [](const process_t* a, const process_t* b) {
+                        return a->mem > b->mem;
+                      });
+    targets.resize(top);
+  }
+
+  // The processes which are no longer shown are forgotten
+  std::map<pid_t, memory_detail_t> details;
+  for (const process_t* process : targets) {
+    const auto it = this->processes.details.find(process->pid);
+    memory_detail_t detail = {};
+    if (it != this->processes.details.end())
+      detail = it->second;
+    detail.name = process->name;
+    details[process->pid] = detail;
+  }
+  this->processes.details = std::move(details);
+
+  if (this->m_memory_detail_pending)
+    return;
+
+  // The stalest entry is the next one to be read
+  const auto now = std::chrono::steady_clock::now();
+  pid_t next = 0;
+  std::chrono::steady_clock::time_point oldest = now;
+  for (const auto& entry : this->processes.details) {
+    const std::chrono::duration<float> age = now - entry.second.updated;
+    if (age.count() >= MEMORY_DETAIL_TTL && entry.second.updated <= oldest) {
+      next = entry.first;
+      oldest = entry.second.updated;
     }
   }
 
-  this->processes.processes = processes;
+  if (next != 0)
+    read_memory_detail_async(next);
+}
+
+void RefreshData::read_memory_detail_async(pid_t pid) {
+  this->processes.details[pid].pending = true;
+  this->m_memory_detail_pending = true;
+
+  this->scheduler->submit([this, pid]() {
+    smaps_rollup_t smaps;
+    const auto begin = std::chrono::steady_clock::now();
+    const bool success = read_smaps_rollup(pid, smaps);
+    const auto end = std::chrono::steady_clock::now();
+
+    std::lock_guard<std::mutex> lock(this->mutex);
+    this->m_memory_detail_pending = false;
+    const auto it = this->processes.details.find(pid);
+    if (it == this->processes.details.end())
+      return;
+
+    memory_detail_t& detail = it->second;
+    detail.pending = false;
+    detail.success = success;
+    detail.smaps = smaps;
+    detail.latency =
+        std::chrono::duration<float, std::milli>(end - begin).count();
+    detail.updated = end;
+  });
+}
+
+void RefreshData::start_profile(pid_t pid, const std::string& name) {
+  if (!this->m_profiler)
+    this->m_profiler.reset(new Profiler());
+
+  const bool started = this->m_profiler->start(
+      pid, name, this->profile.seconds, [this](profile_t result) {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->profile.running = false;
+        this->profile.ready = true;
+        this->profile.result = std::move(result);
+      });
+  if (!started)
+    return;
+
+  this->profile.running = true;
+  this->profile.pid = pid;
+  this->profile.started = std::chrono::steady_clock::now();
 }
 
 std::map<std::string, std::array<uint32_t, 16>> interfaces_values() {
@@ -529,5 +1968,125 @@ void RefreshData::refresh_interfaces() {
     }
   }
 
+  std::lock_guard<std::mutex> lock(this->mutex);
   this->network.interfaces = interfaces;
 }
+
+void RefreshData::refresh_sockets() {
+  socket_filter_t filter;
+  int column;
+  bool descending;
+  {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    if (!this->sockets.shown)
+      return;
+    filter = this->sockets.filter;
+    column = this->sockets.sort_column;
+    descending = this->sockets.sort_descending;
+  }
+
+  const auto begin = std::chrono::steady_clock::now();
+  if (!this->m_socket_diag)
+    this->m_socket_diag.reset(new SocketDiag());
+  const bool success = this->m_socket_diag->dump(filter, this->m_sockets);
+
+  std::sort(this->m_sockets.begin(), this->m_sockets.end(),
+            [column, descending](const socket_t& a, const socket_t& b) {
+              if (descending)
+                return socket_less(b, a, column);
+              return socket_less(a, b, column);
+            });
+  const float duration = std::chrono::duration<float, std::milli>(
+                             std::chrono::steady_clock::now() - begin)
+                             .count();
+
+  std::lock_guard<std::mutex> lock(this->mutex);
+  std::swap(this->sockets.list, this->m_sockets);
+  this->sockets.error = success ? 0 : this->m_socket_diag->error();
+  this->sockets.duration = duration;
+}
+
+void RefreshData::setup_net_stats() {
+  this->m_if_proc_softnet_stat = std::ifstream("/proc/net/softnet_stat");
+  this->m_if_proc_net_snmp = std::ifstream("/proc/net/snmp");
+  this->m_if_proc_net_netstat = std::ifstream("/proc/net/netstat");
+
+  if (this->m_if_proc_softnet_stat.is_open())
+    this->m_softnet_last = read_softnet_stat(this->m_if_proc_softnet_stat);
+
+  std::array<bool, NET_COUNTERS> present = {};
+  this->m_net_counters_last.fill(0);
+  if (this->m_if_proc_net_snmp.is_open())
+    read_net_counters(this->m_if_proc_net_snmp, this->m_net_counters_last,
+                      present);
+  if (this->m_if_proc_net_netstat.is_open())
+    read_net_counters(this->m_if_proc_net_netstat, this->m_net_counters_last,
+                      present);
+  this->m_net_stats_updated = std::chrono::steady_clock::now();
+
+  std::lock_guard<std::mutex> lock(this->mutex);
+  this->network.counters_present = present;
+}
+
+void RefreshData::refresh_net_stats() {
+  const auto now = std::chrono::steady_clock::now();
+  const float seconds =
+      std::chrono::duration<float>(now - this->m_net_stats_updated).count();
+  if (seconds <= 0.0f)
+    return;
+  this->m_net_stats_updated = now;
+
+  std::vector<softnet_cpu_t> cpus;
+  if (this->m_if_proc_softnet_stat.is_open())
+    cpus = read_softnet_stat(this->m_if_proc_softnet_stat);
+
+  // The softnet counters are 32 bits wide, a wrap reads as a smaller value
+  const auto rate = [seconds](uint64_t current, uint64_t last) {
+    return current >= last ? (current - last) / seconds : 0.0f;
+  };
+
+  // CPUs going on or offline change the layout, start over
+  std::vector<softnet_core_t> softnet;
+  for (size_t i = 0; i < cpus.size(); i++) {
+    if (i >= this->m_softnet_last.size() ||
+        this->m_softnet_last[i].cpu != cpus[i].cpu) {
+      softnet.clear();
+      break;
+    }
+
+    const softnet_cpu_t& last = this->m_softnet_last[i];
+    softnet_core_t core;
+    core.cpu = cpus[i].cpu;
+    core.processed = rate(cpus[i].processed, last.processed);
+    core.dropped = rate(cpus[i].dropped, last.dropped);
+    core.time_squeeze = rate(cpus[i].time_squeeze, last.time_squeeze);
+    core.received_rps = rate(cpus[i].received_rps, last.received_rps);
+    core.flow_limit = rate(cpus[i].flow_limit, last.flow_limit);
+    core.total_dropped = cpus[i].dropped;
+    core.total_time_squeeze = cpus[i].time_squeeze;
+    softnet.push_back(core);
+  }
+  this->m_softnet_last = cpus;
+
+  std::array<uint64_t, NET_COUNTERS> counters = this->m_net_counters_last;
+  std::array<bool, NET_COUNTERS> present = {};
+  if (this->m_if_proc_net_snmp.is_open())
+    read_net_counters(this->m_if_proc_net_snmp, counters, present);
+  if (this->m_if_proc_net_netstat.is_open())
+    read_net_counters(this->m_if_proc_net_netstat, counters, present);
+
+  std::array<float, NET_COUNTERS> current;
+  for (int i = 0; i < NET_COUNTERS; i++)
+    current[i] = rate(counters[i], this->m_net_counters_last[i]);
+  this->m_net_counters_last = counters;
+
+  std::lock_guard<std::mutex> lock(this->mutex);
+  this->network.softnet = std::move(softnet);
+  this->network.counters_present = present;
+  this->network.counters = current;
+  for (int i = 0; i < NET_COUNTERS; i++) {
+    std::array<float, 60>& values = this->network.counter_values[i];
+    std::rotate(values.begin(), values.begin() + 1, values.end());
+    values.back() = current[i];
+  }
+}
@@ -5,7 +5,9 @@
 #include <arpa/inet.h>
 #include <array>
 #include <assert.h>
+#include <chrono>
 #include <cpuid.h>
+#include <deque>
 #include <filesystem>
 #include <fstream>
 #include <ifaddrs.h>
@@ -15,9 +17,11 @@
 #include <math.h>
 #include <memory>
 #include <mntent.h>
+#include <mutex>
 #include <net/if.h>
 #include <netinet/in.h>
 #include <pwd.h>
+#include <set>
 #include <sstream>
 #include <stdint.h>
 #include <string.h>
@@ -27,8 +31,23 @@
 #include <sys/sysinfo.h>
 #include <sys/types.h>
 #include <unistd.h>
+#include <unordered_map>
 #include <vector>
 
+#include "batch_reader.hpp"
+#include "cgroups.hpp"
+#include "cpufreq.hpp"
+#include "interrupts.hpp"
+#include "netstat.hpp"
+#include "numa.hpp"
+#include "perf_counters.hpp"
+#include "pressure.hpp"
+#include "profiler.hpp"
+#include "rapl.hpp"
+#include "scheduler.hpp"
+#include "sensors.hpp"
+#include "sockets.hpp"
+
 struct cpu_stat_t {
   uint64_t user;
   uint64_t nice;
@@ -109,12 +128,34 @@ struct pstatm_t {
   std::string cmd;        // command name
 };
 
+// From /proc/<pid>/io
+struct pio_t {
+  bool success;
+  uint64_t rchar;
+  uint64_t wchar;
+  uint64_t read_bytes;
+  uint64_t write_bytes;
+  uint64_t cancelled_write_bytes;
+};
+
+// From /proc/<pid>/schedstat and the context switches of /proc/<pid>/status
+struct psched_t {
+  bool success;
+  uint64_t run_time;  // nanoseconds on a CPU
+  uint64_t wait_time; // nanoseconds runnable, waiting on a run queue
+  uint64_t timeslices;
+  uint64_t voluntary;
+  uint64_t nonvoluntary;
+};
+
 struct process_snap_t {
   pid_t pid;
   std::string name;
   char state;
   pstat_t pstat;
   pstatm_t pstatm;
+  pio_t io;
+  psched_t sched;
 };
 
 struct process_t {
@@ -124,6 +165,182 @@ struct process_t {
   float cpu, mem;
   pstat_t pstat1, pstat2;
   pstatm_t pstatm1, pstatm2;
+
+  // Per second, over the last refresh
+  float minflt_rate;
+  float majflt_rate;
+  float blkio_rate; // clock ticks spent waiting for block I/O
+  bool io;          // whether read_rate and write_rate are known
+  float read_rate;
+  float write_rate;
+  bool sched;      // whether the scheduler rates are known
+  float run_rate;  // milliseconds
+  float wait_rate; // milliseconds
+  float timeslices_rate;
+  float voluntary_rate;
+  float nonvoluntary_rate;
+};
+
+struct process_history_t {
+  std::array<float, 30> wait;
+  std::array<float, 30> nonvoluntary;
+};
+
+struct thread_t {
+  pid_t tid;
+  std::string name;
+  char state;
+  int processor; // last CPU it ran on
+  float cpu;
+};
+
+// From /proc/<pid>/smaps_rollup, in bytes
+struct smaps_rollup_t {
+  uint64_t rss;
+  uint64_t pss;
+  uint64_t pss_anon;
+  uint64_t pss_file;
+  uint64_t pss_shmem;
+  uint64_t shared_clean;
+  uint64_t shared_dirty;
+  uint64_t private_clean;
+  uint64_t private_dirty;
+  uint64_t anonymous;
+  uint64_t swap;
+  uint64_t swap_pss;
+};
+
+struct memory_detail_t {
+  std::string name;
+  bool success;
+  smaps_rollup_t smaps;
+
+  bool pending;
+  float latency; // milliseconds, last read
+  std::chrono::steady_clock::time_point updated;
+};
+
+// Counters of /proc/vmstat, the scans and steals are summed over kswapd,
+// direct reclaim, khugepaged and proactive reclaim
+enum vmstat_counter_t {
+  VMSTAT_SWAP_IN,
+  VMSTAT_SWAP_OUT,
+  VMSTAT_MAJOR_FAULTS,
+  VMSTAT_SCANNED,
+  VMSTAT_STOLEN,
+  VMSTAT_THP_ALLOC,
+  VMSTAT_THP_FALLBACK,
+  // Gauges, in pages
+  VMSTAT_DIRTY,
+  VMSTAT_WRITEBACK,
+  VMSTAT_COUNTERS,
+};
+
+struct slab_cache_t {
+  std::string name;
+  uint64_t active_objects;
+  uint64_t objects;
+  uint64_t active_bytes; // active objects times their size
+  uint64_t bytes;        // slabs times their pages
+  float growth;          // bytes per second over the history
+  int samples;           // valid entries at the end of values
+  std::array<float, 60> values; // bytes
+};
+
+// Derived from the node statistics over the last refresh
+struct numa_node_t {
+  numa_node_stat_t stat;
+  // Pages per second
+  float hit_rate;
+  float miss_rate;
+  float foreign_rate;
+  float other_rate;
+};
+
+// Per node memory of a process, read on demand
+struct numa_placement_t {
+  pid_t pid;
+  std::string name;
+  bool pending;
+  bool success;
+  std::map<int, uint64_t> nodes; // bytes
+  float latency;                 // milliseconds
+};
+
+struct pressure_t {
+  bool present;
+  bool armed; // a PSI trigger is registered
+  pressure_sample_t current;
+  // Percents of the time stalled over the last refresh
+  float some;
+  float full;
+  std::array<float, 60> some_values;
+  std::array<float, 60> full_values;
+  uint64_t triggered; // wakeups by the trigger
+};
+
+struct cgroup_t {
+  std::string path; // relative to the cgroup2 root, "" for the root
+  std::string name;
+  int depth;
+  cgroup_stat_t stat;
+
+  // Over the last refresh
+  float cpu;       // percents of one CPU
+  float throttled; // percents of the time
+  float read_rate;
+  float write_rate;
+  std::array<float, 60> cpu_values;
+  std::array<float, 60> memory_values;
+
+  // cgroup.procs, only read while the cgroup is expanded
+  std::vector<pid_t> procs;
+};
+
+// Derived from the counters over the last refresh
+struct perf_core_t {
+  // Hardware
+  float ipc;
+  float cache_miss;  // percents of the cache references
+  float branch_miss; // percents of the branches
+  float stalled;     // percents of the cycles, frontend and backend
+  // Software, per second
+  float context_switches;
+  float page_faults;
+  float migrations;
+};
+
+// Cumulated per core counters of /proc/schedstat
+struct schedstat_cpu_t {
+  int cpu;
+  uint64_t running;    // nanoseconds spent running tasks
+  uint64_t waiting;    // nanoseconds spent by tasks on the run queue
+  uint64_t timeslices; // tasks run
+};
+
+// Derived from the schedstat counters over the last refresh
+struct run_queue_t {
+  int cpu;
+  float running;    // percents of the wall time
+  float waiting;    // milliseconds waited per second, by all the tasks
+  float timeslices; // per second
+  float latency;    // average wait before each timeslice, in microseconds
+};
+
+// Derived from the cpufreq samples over the last refresh
+struct core_frequency_t {
+  int cpu;
+  float frequency; // MHz
+  float max;       // MHz, 0 when unknown
+  uint64_t core_throttles;
+  uint64_t package_throttles;
+  float throttle_rate; // core throttling events per second
+};
+
+struct power_domain_t {
+  std::string name;
+  float watts;
+  std::array<float, 60> values;
 };
 
 struct interface_t {
@@ -134,38 +351,98 @@ struct interface_t {
   std::array<uint32_t, 16> values;
 };
 
+// Derived from the softnet counters over the last refresh, per second
+struct softnet_core_t {
+  int cpu;
+  float processed;
+  float dropped;
+  float time_squeeze;
+  float received_rps;
+  float flow_limit;
+  uint64_t total_dropped;
+  uint64_t total_time_squeeze;
+};
+
 class RefreshData {
 public:
-  static std::shared_ptr<RefreshData> init();
+  // scan_workers caps the threads scanning /proc, 0 picks half of the cores
+  // up to 8
+  static std::shared_ptr<RefreshData> init(int scan_workers = 0);
+
+  // Registers the periodic collectors on the scheduler
+  void start_collectors(float refresh_rate);
+  // Applies the "Animate" and "FPS" settings to the graph collectors, must be
+  // called with the mutex held
+  void apply_graph_settings();
 
   void refresh_operating_system();
   void refresh_user();
   void refresh_hostname();
   void refresh_cpu_info();
 
-  // Battery
-  bool setup_refresh_battery(const char* procfile_now,
-                             const char* procfile_full,
-                             const char* procfile_status);
-  void refresh_battery_full();
-  void refresh_battery();
-
-  // Thermal
-  bool setup_refresh_thermal(const char* procfile);
-  void refresh_thermal();
-
-  // Fan
-  bool setup_refresh_fan(const char* procfile);
-  void refresh_fan();
+  // hwmon, thermal zones and power supplies
+  void setup_sensors();
+  void refresh_sensors();
 
   bool setup_proc();
   void refresh_cpu_stat(bool initial = false);
   void refresh_cpu_graph_stat(bool initial = false);
+
+  void setup_perf_counters();
+  void refresh_perf_counters();
+  // Needs a kernel built with CONFIG_SCHEDSTATS
+  void setup_schedstat();
+  void refresh_schedstat();
+  void setup_interrupts();
+  void refresh_interrupts();
+  void setup_cpufreq();
+  void refresh_cpufreq();
+  // RAPL energy counters of the powercap class
+  void setup_rapl();
+  void refresh_rapl();
   void refresh_memory();
+  void refresh_vmstat();
+  // /proc/slabinfo is only readable by root
+  void refresh_slabinfo();
+
+  void setup_pressure();
+  void refresh_pressure();
+
+  void setup_numa();
+  void refresh_numa();
+  // Reads /proc/<pid>/numa_maps on a worker, must be called with the mutex
+  // held
+  void read_numa_maps_async(pid_t pid, const std::string& name);
 
   void refresh_storages();
+
+  void setup_cgroups();
+  void refresh_cgroups();
   void refresh_processes(bool initial = false);
+  void refresh_memory_details();
+  // Samples the process for profile.seconds on the profiler thread, must be
+  // called with the mutex held
+  void start_profile(pid_t pid, const std::string& name);
   void refresh_interfaces();
+  // Per CPU backlog of /proc/net/softnet_stat and the error counters of
+  // /proc/net/snmp and /proc/net/netstat
+  void setup_net_stats();
+  void refresh_net_stats();
+  // Dumps the sockets matching sockets.filter while they are shown
+  void refresh_sockets();
+
+  // Set once the first refresh of each section has been done
+  struct {
+    bool system;
+    bool cpu;
+    bool sensors;
+    bool memory;
+    bool pressure;
+    bool cgroups;
+    bool storages;
+    bool network;
+    bool processes;
+  } ready;
 
   pid_t pid;
   std::string operating_system;
@@ -185,24 +462,78 @@ public:
   } cpu_graph;
 
   struct {
-    uint64_t now;
-    uint64_t full;
+    std::vector<cpu_stat_t> last;
+    std::vector<float> usage;
+    uint64_t generation;
+  } cpu_cores;
+
+  struct {
+    perf_mode_t mode;
+    int error;
+    std::vector<perf_core_t> cores;
+    // Average of the cores: IPC, cache, branch misses and stalls with the
+    // hardware counters, context switches, page faults and migrations with
+    // the software ones
+    std::array<std::array<float, 60>, 4> series;
+  } perf;
+
+  struct {
+    bool present;
+    std::vector<run_queue_t> cores;
+  } run_queues;
+
+  struct {
+    int cpus;
+    std::vector<int> cpu_ids;       // of the columns of the rates
+    std::vector<irq_source_t> hard; // /proc/interrupts
+    std::vector<irq_source_t> soft; // /proc/softirqs
+    size_t parsed;                  // rows which changed at the last refresh
+    uint64_t generation;
+    // Written by the UI
+    bool show_soft;
+    bool hide_idle;
+  } interrupts;
+
+  std::vector<sensor_t> sensors;
+  float sensors_interval; // before throttling
+
+  // The first battery, thermal zone and fan found among the sensors
+  struct {
+    bool present;
+    float now;
+    float full;
+    const char* unit;
     std::string status;
     std::array<float, 60> values;
   } battery;
 
   struct {
-    uint64_t current;
+    bool present;
+    float current;
     std::array<float, 60> values;
   } thermal;
 
   struct {
-    uint64_t current;
+    bool present;
+    float current;
     std::array<float, 60> values;
   } fan;
 
   struct {
-    float refresh_accumulator;
+    int error; // errno when a zone could not be read, EACCES without root
+    std::vector<power_domain_t> domains;
+  } power;
+
+  struct {
+    bool frequency;
+    bool throttling;
+    std::vector<core_frequency_t> cores;
+    float max;                       // highest maximum of the cores, MHz
+    std::array<float, 60> values;    // average frequency, MHz
+    std::array<float, 60> throttles; // events per second, all the cores
+  } cpufreq;
+
+  struct {
     float fps;
     bool animated;
     float yscale;
@@ -218,35 +549,197 @@ public:
     float virt_percent;
   } memory;
 
+  struct {
+    bool present;
+    // Per second, pages for the gauges
+    std::array<float, VMSTAT_COUNTERS> current;
+    std::array<std::array<float, 60>, VMSTAT_COUNTERS> values;
+  } vmstat;
+
   long pages;
   long processors;
   long page_size;
   unsigned long long total_memory;
 
+  struct {
+    bool present;
+    int error;
+    uint64_t bytes;
+    float window; // seconds covered by the growth rates
+    std::vector<slab_cache_t> caches;
+  } slabs;
+
+  struct {
+    std::vector<numa_node_t> nodes; // empty without NUMA support
+    numa_placement_t placement;
+  } numa;
+
   std::vector<storage_t> storages;
 
+  std::array<pressure_t, PRESSURE_RESOURCES> pressure;
+
+  struct {
+    std::string root; // empty without cgroup v2
+    bool inotify;
+    std::vector<cgroup_t> tree; // depth first
+    // Written by the UI, cgroup_t::procs is only read for these
+    std::set<std::string> expanded;
+  } cgroups;
+
   struct {
     std::vector<process_snap_t> snap_past;
     std::vector<process_snap_t> snap_pres;
     std::vector<process_t> processes;
+    // Only collected for the expanded processes
+    std::map<pid_t, std::vector<thread_t>> threads;
+    // Selected processes, or the top ones by memory usage when there is no
+    // selection. Only refreshed while shown.
+    std::map<pid_t, memory_detail_t> details;
+    bool details_shown;
+    // /proc/<pid>/io is only read while its columns are shown
+    bool io_shown;
+    // Likewise for /proc/<pid>/schedstat and /proc/<pid>/status
+    bool sched_shown;
+    std::unordered_map<pid_t, process_history_t> history;
+
+    // Cost of the last refresh
+    uint64_t shards;
+    uint64_t files;
+    uint64_t syscalls;
+    bool uring;
   } processes;
 
   struct {
     std::vector<interface_t> interfaces;
+
+    std::vector<softnet_core_t> softnet; // empty without softnet_stat
+    std::array<bool, NET_COUNTERS> counters_present;
+    std::array<float, NET_COUNTERS> counters; // per second
+    std::array<std::array<float, 60>, NET_COUNTERS> counter_values;
   } network;
 
+  struct {
+    // Written by the UI, which triggers the collector when they change
+    bool shown;
+    socket_filter_t filter;
+    int sort_column;
+    bool sort_descending;
+
+    int error;
+    float duration; // milliseconds taken by the last dump and sort
+    std::vector<socket_t> list; // sorted by the collector
+  } sockets;
+
+  struct {
+    bool running;
+    pid_t pid; // of the running profile
+    float seconds;
+    std::chrono::steady_clock::time_point started;
+    bool ready;
+    profile_t result;
+  } profile;
+
   std::vector<pid_t> processes_selection;
+  std::vector<pid_t> processes_expanded;
   char processes_filter[64];
 
+  // The collectors run on the scheduler workers: the refresh_* methods do
+  // their reads without it and only hold it while publishing the results,
+  // the UI holds it while drawing.
+  std::mutex mutex;
+  std::unique_ptr<Scheduler> scheduler;
+  float refresh_rate;
+  int scan_workers;
+
+  struct {
+    int cpu_graph;
+    int sensors;
+    int pressure;
+    int sockets;
+  } collectors;
+
 private:
-  std::ifstream m_if_battery_now;
-  std::ifstream m_if_battery_full;
-  std::ifstream m_if_battery_status;
-  std::ifstream m_if_thermal;
-  std::ifstream m_if_fan;
+  void update_cpu_cores(const std::vector<cpu_stat_t>& cores);
+  std::map<pid_t, std::vector<thread_t>>
+  refresh_threads(const std::vector<pid_t>& expanded, float cpu_total);
+  void read_memory_detail_async(pid_t pid);
+
+  void read_sensor_async(size_t index);
+  void update_sensors_summary();
+
+  uint64_t m_sensors_generation;
+  std::string m_sensors_signature;
+  std::chrono::steady_clock::time_point m_sensors_checked;
+  struct {
+    int battery_now;
+    int battery_full;
+    int battery_status;
+    int thermal;
+    int fan;
+  } m_sensors_primary;
 
   std::ifstream m_if_proc_stat;
+  std::ifstream m_if_proc_stat_graph;
   std::ifstream m_if_proc_meminfo;
+  std::ifstream m_if_proc_vmstat;
+  std::array<uint64_t, VMSTAT_COUNTERS> m_vmstat_last;
+  std::chrono::steady_clock::time_point m_vmstat_updated;
+  std::array<std::ifstream, PRESSURE_RESOURCES> m_if_proc_pressure;
+  std::chrono::steady_clock::time_point m_pressure_updated;
+  std::unique_ptr<PressureTriggers> m_pressure_triggers;
+
+  std::unique_ptr<PerfCounters> m_perf_counters;
+  std::vector<perf_values_t> m_perf_last;
+  std::chrono::steady_clock::time_point m_perf_updated;
+
+  std::ifstream m_if_proc_schedstat;
+  std::vector<schedstat_cpu_t> m_schedstat_last;
+  std::chrono::steady_clock::time_point m_schedstat_updated;
+
+  // Owned by the interrupts collector, copied over the published ones
+  std::unique_ptr<InterruptCounters> m_interrupts_hard;
+  std::unique_ptr<InterruptCounters> m_interrupts_soft;
+  std::vector<irq_source_t> m_irq_hard;
+  std::vector<irq_source_t> m_irq_soft;
+  std::chrono::steady_clock::time_point m_interrupts_updated;
+
+  std::unique_ptr<CpuFrequencies> m_cpufreq;
+  std::vector<cpufreq_sample_t> m_cpufreq_last;
+  std::chrono::steady_clock::time_point m_cpufreq_updated;
+
+  // Time of each sample of the slab histories, the oldest first
+  std::deque<std::chrono::steady_clock::time_point> m_slab_times;
+
+  std::vector<int> m_numa_nodes;
+  std::vector<numa_node_stat_t> m_numa_last;
+  std::vector<char> m_numa_known; // numastat was read once
+  std::chrono::steady_clock::time_point m_numa_updated;
+
+  std::ifstream m_if_proc_softnet_stat;
+  std::ifstream m_if_proc_net_snmp;
+  std::ifstream m_if_proc_net_netstat;
+  std::vector<softnet_cpu_t> m_softnet_last;
+  std::array<uint64_t, NET_COUNTERS> m_net_counters_last;
+  std::chrono::steady_clock::time_point m_net_stats_updated;
+
+  // Swapped with sockets.list so that both keep their capacity
+  std::unique_ptr<SocketDiag> m_socket_diag;
+  std::vector<socket_t> m_sockets;
+
+  std::unique_ptr<Rapl> m_rapl;
+  std::vector<uint64_t> m_rapl_last;
+  std::chrono::steady_clock::time_point m_rapl_updated;
+
+  std::unique_ptr<CgroupTree> m_cgroup_tree;
+  std::chrono::steady_clock::time_point m_cgroups_updated;
+
+  std::unique_ptr<Profiler> m_profiler;
+
+  std::unique_ptr<WorkerPool> m_scan_pool;
+  // utime + stime of the threads of the expanded processes, by TID
+  std::unordered_map<pid_t, unsigned long> m_thread_times;
+  bool m_memory_detail_pending;
+  std::chrono::steady_clock::time_point m_processes_updated;
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,260 @@
+#include "scheduler.hpp"
+
+#include <algorithm>
+
+constexpr std::chrono::milliseconds Scheduler::WHEEL_TICK;
+
+Scheduler::Scheduler(int workers)
+    : m_pool(workers), m_epoch(clock::now()), m_tick(0),
+      m_expensive_running(0), m_stop(false) {
+  m_thread = std::thread(&Scheduler::loop, this);
+}
+
+Scheduler::~Scheduler() { stop(); }
+
+int Scheduler::add(const std::string& name, collector_cost_t cost,
+                   float interval, float jitter, std::function<void()> run) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  slot_t slot = {};
+  slot.collector.name = name;
+  slot.collector.run = std::move(run);
+  slot.collector.cost = cost;
+  slot.collector.interval = interval;
+  slot.collector.jitter = jitter;
+  m_slots.push_back(slot);
+
+  const int id = m_slots.size() - 1;
+  if (interval > 0.0f)
+    schedule(id, clock::now());
+  return id;
+}
+
+int Scheduler::run_once(const std::string& name, collector_cost_t cost,
+                        std::function<void()> run) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  slot_t slot = {};
+  slot.collector.name = name;
+  slot.collector.run = std::move(run);
+  slot.collector.cost = cost;
+  slot.collector.one_shot = true;
+  m_slots.push_back(slot);
+
+  const int id = m_slots.size() - 1;
+  schedule(id, clock::now());
+  return id;
+}
+
+void Scheduler::submit(std::function<void()> job) {
+  m_pool.submit(clock::now(), std::move(job));
+}
+
+void Scheduler::trigger(int id) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  slot_t& slot = m_slots[id];
+  if (m_stop || slot.collector.running || slot.collector.one_shot)
+    return;
+  schedule(id, clock::now());
+}
+
+void Scheduler::set_interval(int id, float interval) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  slot_t& slot = m_slots[id];
+  const float previous = slot.collector.interval;
+  if (previous == interval || slot.collector.one_shot)
+    return;
+
+  slot.collector.interval = interval;
+  if (slot.collector.running)
+    return; // Rescheduled with the new interval once it has finished
+
+  if (interval <= 0.0f) {
+    slot.tick = 0;
+    return;
+  }
+
+  // Keep the time of the last run as the reference so that dragging the
+  // interval around does not postpone the collector forever.
+  const clock::time_point now = clock::now();
+  clock::time_point deadline = now;
+  if (previous > 0.0f) {
+    deadline = slot.deadline -
+               std::chrono::duration_cast<clock::duration>(
+                   std::chrono::duration<float>(previous)) +
+               std::chrono::duration_cast<clock::duration>(
+                   std::chrono::duration<float>(interval));
+    deadline = std::max(deadline, now);
+  }
+  schedule(id, deadline);
+}
+
+float Scheduler::interval(int id) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_slots[id].collector.interval;
+}
+
+std::vector<collector_t> Scheduler::collectors() {
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  std::vector<collector_t> collectors;
+  for (const slot_t& slot : m_slots)
+    collectors.push_back(slot.collector);
+  return collectors;
+}
+
+void Scheduler::stop() {
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_stop)
+      return;
+    m_stop = true;
+  }
+  m_cv.notify_all();
+
+  m_thread.join();
+  m_pool.stop();
+}
+
+uint64_t Scheduler::to_tick(clock::time_point tp) const {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(tp - m_epoch) /
+         WHEEL_TICK;
+}
+
+void Scheduler::schedule(int id, clock::time_point deadline) {
+  slot_t& slot = m_slots[id];
+  slot.deadline = deadline;
+
+  // Rounding down to the jitter of the collector lets the collectors which
+  // tolerate the same jitter be woken up together.
+  const uint64_t quantum = std::max<uint64_t>(
+      1, (uint64_t)(slot.collector.jitter * 1000.0f) / WHEEL_TICK.count());
+  const uint64_t tick =
+      std::max(to_tick(deadline) / quantum * quantum, m_tick + 1);
+
+  slot.tick = tick;
+  m_wheel[tick % WHEEL_SLOTS].push_back(entry_t{id, tick});
+  m_cv.notify_one();
+}
+
+void Scheduler::dispatch(int id) {
+  slot_t& slot = m_slots[id];
+  collector_t& collector = slot.collector;
+
+  if (collector.running) {
+    collector.overruns++;
+    return;
+  }
+
+  if (collector.cost == COLLECTOR_EXPENSIVE) {
+    if (m_expensive_running > 0) {
+      if (std::find(m_deferred.begin(), m_deferred.end(), id) ==
+          m_deferred.end())
+        m_deferred.push_back(id);
+      return;
+    }
+    m_expensive_running++;
+  }
+
+  collector.running = true;
+
+  const std::function<void()> run = collector.run;
+  m_pool.submit(slot.deadline, [this, id, run]() {
+    const clock::time_point started = clock::now();
+    run();
+    finish(id, started);
+  });
+}
+
+void Scheduler::finish(int id, clock::time_point started) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  slot_t& slot = m_slots[id];
+  collector_t& collector = slot.collector;
+  const clock::time_point now = clock::now();
+
+  collector.running = false;
+  collector.runs++;
+  collector.duration =
+      std::chrono::duration<float, std::milli>(now - started).count();
+
+  if (collector.cost == COLLECTOR_EXPENSIVE) {
+    m_expensive_running--;
+    if (!m_deferred.empty()) {
+      const int next = m_deferred.front();
+      m_deferred.erase(m_deferred.begin());
+      dispatch(next);
+    }
+  }
+
+  if (m_stop || collector.one_shot || collector.interval <= 0.0f)
+    return;
+
+  // Keep the cadence, but do not try to catch up with the missed runs
+  const clock::duration interval = std::chrono::duration_cast<clock::duration>(
+      std::chrono::duration<float>(collector.interval));
+  clock::time_point deadline = slot.deadline + interval;
+  if (deadline < now)
+    deadline = now + interval;
+  schedule(id, deadline);
+}
+
+void Scheduler::loop() {
+  std::unique_lock<std::mutex> lock(m_mutex);
+
+  while (!m_stop) {
+    // Sleep until the next slot having entries, or until notified
+    uint64_t next = 0;
+    for (uint64_t tick = m_tick + 1; tick <= m_tick + WHEEL_SLOTS; tick++) {
+      if (!m_wheel[tick % WHEEL_SLOTS].empty()) {
+        next = tick;
+        break;
+      }
+    }
+
+    if (next == 0)
+      m_cv.wait(lock);
+    else
+      m_cv.wait_until(lock, m_epoch + next * WHEEL_TICK);
+
+    if (m_stop)
+      break;
+
+    const uint64_t now = to_tick(clock::now());
+    if (now <= m_tick)
+      continue;
+
+    // Advance the wheel, at most one turn is needed to see every entry
+    std::vector<int> due;
+    const uint64_t steps = std::min<uint64_t>(now - m_tick, WHEEL_SLOTS);
+    for (uint64_t step = 1; step <= steps; step++) {
+      std::vector<entry_t>& bucket = m_wheel[(m_tick + step) % WHEEL_SLOTS];
+      for (size_t i = 0; i < bucket.size();) {
+        const entry_t entry = bucket[i];
+        if (entry.tick > now) {
+          i++;
+          continue;
+        }
+
+        bucket[i] = bucket.back();
+        bucket.pop_back();
+
+        // Entries left behind by a rescheduling are simply dropped
+        if (m_slots[entry.id].tick == entry.tick) {
+          m_slots[entry.id].tick = 0;
+          due.push_back(entry.id);
+        }
+      }
+    }
+    m_tick = now;
+
+    std::sort(due.begin(), due.end(), [this](int a, int b) {
+      return m_slots[a].deadline < m_slots[b].deadline;
+    });
+
+    for (int id : due)
+      dispatch(id);
+  }
+}
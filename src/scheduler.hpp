@@ -0,0 +1,102 @@
+#ifndef __SCHEDULER_HPP__
+#define __SCHEDULER_HPP__
+
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "worker_pool.hpp"
+
+enum collector_cost_t {
+  COLLECTOR_CHEAP,
+  COLLECTOR_MODERATE,
+  // At most one expensive collector runs at a time so that they cannot
+  // occupy the whole pool and delay the cheap, frequent ones.
+  COLLECTOR_EXPENSIVE,
+};
+
+struct collector_t {
+  std::string name;
+  std::function<void()> run;
+  collector_cost_t cost;
+  float interval; // seconds, 0 disables the collector
+  float jitter;   // seconds the run may be advanced to be grouped with others
+  bool one_shot;
+
+  bool running;
+  uint64_t runs;
+  uint64_t overruns;
+  float duration; // last run, in milliseconds
+};
+
+// Timer wheel driving the collectors. Each collector has its own interval,
+// the due ones are handed to a worker pool ordered by deadline. A collector
+// never runs concurrently with itself: if it is still running when it is due
+// again, the run is skipped and counted as an overrun.
+class Scheduler {
+public:
+  typedef std::chrono::steady_clock clock;
+
+  Scheduler(int workers);
+  ~Scheduler();
+
+  int add(const std::string& name, collector_cost_t cost, float interval,
+          float jitter, std::function<void()> run);
+  int run_once(const std::string& name, collector_cost_t cost,
+               std::function<void()> run);
+  // Runs a background job on the pool as soon as a worker is available,
+  // without the bookkeeping of the collectors.
+  void submit(std::function<void()> job);
+
+  // Runs a collector as soon as possible, its cadence then resumes from that
+  // run. Nothing is done if it is already running.
+  void trigger(int id);
+
+  void set_interval(int id, float interval);
+  float interval(int id);
+  std::vector<collector_t> collectors();
+
+  void stop();
+
+private:
+  static const int WHEEL_SLOTS = 512;
+  static constexpr std::chrono::milliseconds WHEEL_TICK{5};
+
+  struct entry_t {
+    int id;
+    uint64_t tick;
+  };
+
+  struct slot_t {
+    collector_t collector;
+    clock::time_point deadline;
+    uint64_t tick; // tick of the pending wheel entry, 0 if none
+  };
+
+  uint64_t to_tick(clock::time_point tp) const;
+  void schedule(int id, clock::time_point deadline);
+  void dispatch(int id);
+  void finish(int id, clock::time_point started);
+  void loop();
+
+  std::mutex m_mutex;
+  std::condition_variable m_cv;
+  std::thread m_thread;
+  WorkerPool m_pool;
+
+  clock::time_point m_epoch;
+  uint64_t m_tick;
+  std::array<std::vector<entry_t>, WHEEL_SLOTS> m_wheel;
+  std::vector<slot_t> m_slots;
+
+  int m_expensive_running;
+  std::vector<int> m_deferred;
+  bool m_stop;
+};
+
+#endif
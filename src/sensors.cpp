@@ -0,0 +1,220 @@
+#include "sensors.hpp"
+
+#include <algorithm>
+#include <ctype.h>
+#include <fcntl.h>
+#include <filesystem>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+struct sensor_attribute_t {
+  const char* name;
+  sensor_kind_t kind;
+  const char* unit;
+  float scale;
+};
+
+// Units are documented in Documentation/hwmon/sysfs-interface.rst
+static const sensor_attribute_t HWMON_ATTRIBUTES[] = {
+    {"temp", SENSOR_TEMPERATURE, "°C", 1e-3f},
+    {"fan", SENSOR_FAN, "RPM", 1.0f},
+    {"in", SENSOR_VOLTAGE, "V", 1e-3f},
+    {"curr", SENSOR_CURRENT, "A", 1e-3f},
+    {"power", SENSOR_POWER, "W", 1e-6f},
+    {"energy", SENSOR_ENERGY, "J", 1e-6f},
+};
+
+// And in Documentation/ABI/testing/sysfs-class-power
+static const sensor_attribute_t POWER_SUPPLY_ATTRIBUTES[] = {
+    {"status", SENSOR_STATUS, "", 1.0f},
+    {"online", SENSOR_ONLINE, "", 1.0f},
+    {"capacity", SENSOR_CAPACITY, "%", 1.0f},
+    {"energy_now", SENSOR_ENERGY, "Wh", 1e-6f},
+    {"energy_full", SENSOR_ENERGY, "Wh", 1e-6f},
+    {"charge_now", SENSOR_CHARGE, "Ah", 1e-6f},
+    {"charge_full", SENSOR_CHARGE, "Ah", 1e-6f},
+    {"power_now", SENSOR_POWER, "W", 1e-6f},
+    {"current_now", SENSOR_CURRENT, "A", 1e-6f},
+    {"voltage_now", SENSOR_VOLTAGE, "V", 1e-6f},
+    {"temp", SENSOR_TEMPERATURE, "°C", 1e-1f},
+};
+
+// Orders "hwmon2" before "hwmon10"
+static bool natural_less(const std::string& a, const std::string& b) {
+  size_t i = 0, j = 0;
+  while (i < a.size() && j < b.size()) {
+    if (isdigit(a[i]) && isdigit(b[j])) {
+      char *end_a, *end_b;
+      const unsigned long long na = strtoull(a.c_str() + i, &end_a, 10);
+      const unsigned long long nb = strtoull(b.c_str() + j, &end_b, 10);
+      if (na != nb)
+        return na < nb;
+      i = end_a - a.c_str();
+      j = end_b - b.c_str();
+    } else {
+      if (a[i] != b[j])
+        return a[i] < b[j];
+      i++;
+      j++;
+    }
+  }
+  return a.size() - i < b.size() - j;
+}
+
+static std::vector<std::string> list_directory(const std::string& path) {
+  std::vector<std::string> entries;
+
+  std::error_code ec;
+  for (const auto& e : std::filesystem::directory_iterator(path, ec))
+    entries.push_back(e.path().filename().string());
+
+  std::sort(entries.begin(), entries.end(), natural_less);
+  return entries;
+}
+
+static std::string read_text(const std::string& path) {
+  char buffer[256];
+  const int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0)
+    return "";
+
+  const ssize_t n = read(fd, buffer, sizeof(buffer) - 1);
+  close(fd);
+  if (n <= 0)
+    return "";
+
+  buffer[n] = '\0';
+  buffer[strcspn(buffer, "\n")] = '\0';
+  return std::string(buffer);
+}
+
+static bool add_sensor(std::vector<sensor_t>& sensors, const std::string& path,
+                       const char* source, const std::string& device,
+                       const std::string& label,
+                       const sensor_attribute_t& attribute) {
+  const int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0)
+    return false;
+
+  sensor_t sensor = {};
+  sensor.path = path;
+  sensor.source = source;
+  sensor.device = device;
+  sensor.label = label;
+  sensor.kind = attribute.kind;
+  sensor.unit = attribute.unit;
+  sensor.file.reset(new sensor_file_t{fd, attribute.kind, attribute.scale});
+  sensors.push_back(sensor);
+  return true;
+}
+
+static void discover_hwmon(std::vector<sensor_t>& sensors,
+                           const std::string& root) {
+  for (const std::string& hwmon : list_directory(root + "/hwmon")) {
+    const std::string dir = root + "/hwmon/" + hwmon;
+    const std::string name = read_text(dir + "/name");
+
+    for (const std::string& file : list_directory(dir)) {
+      // <type><index>_input, power meters may only provide an average
+      size_t suffix = file.rfind("_input");
+      if (suffix == std::string::npos || suffix + 6 != file.size()) {
+        suffix = file.rfind("_average");
+        if (suffix == std::string::npos || suffix + 8 != file.size() ||
+            file.compare(0, 5, "power") != 0)
+          continue;
+      }
+
+      const std::string channel = file.substr(0, suffix);
+      const size_t digits = channel.find_first_of("0123456789");
+      if (digits == std::string::npos)
+        continue;
+
+      const std::string type = channel.substr(0, digits);
+      for (const sensor_attribute_t& attribute : HWMON_ATTRIBUTES) {
+        if (type != attribute.name)
+          continue;
+
+        std::string label = read_text(dir + "/" + channel + "_label");
+        if (label.empty())
+          label = channel;
+
+        add_sensor(sensors, dir + "/" + file, "hwmon",
+                   name.empty() ? hwmon : name, label, attribute);
+        break;
+      }
+    }
+  }
+}
+
+static void discover_thermal(std::vector<sensor_t>& sensors,
+                             const std::string& root) {
+  static const sensor_attribute_t temp = {"temp", SENSOR_TEMPERATURE, "°C",
+                                          1e-3f};
+
+  for (const std::string& zone : list_directory(root + "/thermal")) {
+    if (zone.rfind("thermal_zone", 0) != 0)
+      continue;
+
+    const std::string dir = root + "/thermal/" + zone;
+    const std::string type = read_text(dir + "/type");
+    add_sensor(sensors, dir + "/temp", "thermal", zone,
+               type.empty() ? "temp" : type, temp);
+  }
+}
+
+static void discover_power_supply(std::vector<sensor_t>& sensors,
+                                  const std::string& root) {
+  for (const std::string& supply : list_directory(root + "/power_supply")) {
+    const std::string dir = root + "/power_supply/" + supply;
+
+    for (const sensor_attribute_t& attribute : POWER_SUPPLY_ATTRIBUTES)
+      add_sensor(sensors, dir + "/" + attribute.name, "power_supply", supply,
+                 attribute.name, attribute);
+  }
+}
+
+std::vector<sensor_t> discover_sensors(const std::string& root) {
+  std::vector<sensor_t> sensors;
+  discover_hwmon(sensors, root);
+  discover_thermal(sensors, root);
+  discover_power_supply(sensors, root);
+  return sensors;
+}
+
+std::string sensors_signature(const std::string& root) {
+  std::string signature;
+  for (const char* cls : {"/hwmon", "/thermal", "/power_supply"}) {
+    for (const std::string& entry : list_directory(root + cls))
+      signature += entry + ";";
+    signature += "|";
+  }
+  return signature;
+}
+
+sensor_file_t::~sensor_file_t() {
+  if (fd >= 0)
+    close(fd);
+}
+
+bool read_sensor(const sensor_file_t& file, float& value, std::string& text) {
+  char buffer[64];
+  const ssize_t n = pread(file.fd, buffer, sizeof(buffer) - 1, 0);
+  if (n <= 0)
+    return false;
+
+  buffer[n] = '\0';
+  if (file.kind == SENSOR_STATUS) {
+    buffer[strcspn(buffer, "\n")] = '\0';
+    text = buffer;
+    return true;
+  }
+
+  char* end;
+  const long long raw = strtoll(buffer, &end, 10);
+  if (end == buffer)
+    return false;
+
+  value = raw * file.scale;
+  return true;
+}
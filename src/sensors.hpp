@@ -0,0 +1,67 @@
+#ifndef __SENSORS_HPP__
+#define __SENSORS_HPP__
+
+#include <array>
+#include <chrono>
+#include <memory>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+enum sensor_kind_t {
+  SENSOR_TEMPERATURE,
+  SENSOR_FAN,
+  SENSOR_VOLTAGE,
+  SENSOR_CURRENT,
+  SENSOR_POWER,
+  SENSOR_ENERGY,
+  SENSOR_CHARGE,
+  SENSOR_CAPACITY,
+  SENSOR_ONLINE,
+  SENSOR_STATUS, // Textual, e.g. "Charging"
+};
+
+// Shared with the reads in flight so that a rediscovery cannot close the
+// descriptor under them.
+struct sensor_file_t {
+  int fd; // kept open, read with pread() at offset 0
+  sensor_kind_t kind;
+  float scale; // from the raw sysfs value to the unit
+
+  ~sensor_file_t();
+};
+
+struct sensor_t {
+  std::string path;   // sysfs attribute, also used as identifier
+  std::string source; // "hwmon", "thermal" or "power_supply"
+  std::string device; // hwmon name, "thermal_zone<n>" or supply name
+  // <attribute>_label when available, the type of a thermal zone, else the
+  // attribute
+  std::string label;
+  sensor_kind_t kind;
+  const char* unit;
+  std::shared_ptr<sensor_file_t> file;
+
+  float current;
+  std::string text;
+  std::array<float, 60> values;
+
+  // Each sensor is read asynchronously at its own pace: slow ones (ACPI
+  // batteries, embedded controllers) are throttled based on their latency.
+  bool pending;
+  float latency;  // milliseconds, smoothed
+  float interval; // seconds
+  std::chrono::steady_clock::time_point updated;
+  std::chrono::steady_clock::time_point next;
+};
+
+// Enumerates /sys/class/{hwmon,thermal,power_supply} below root. The sensors
+// have their file opened and their values zeroed.
+std::vector<sensor_t> discover_sensors(const std::string& root = "/sys/class");
+// Cheap fingerprint of the devices present, used to detect hotplug
+std::string sensors_signature(const std::string& root = "/sys/class");
+
+// Reads the current value, text is only filled for SENSOR_STATUS sensors
+bool read_sensor(const sensor_file_t& file, float& value, std::string& text);
+
+#endif
@@ -0,0 +1,344 @@
+#include "sockets.hpp"
+
+#include <algorithm>
+#include <arpa/inet.h>
+#include <errno.h>
+#include <linux/inet_diag.h>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+#include <linux/sock_diag.h>
+#include <linux/tcp.h>
+#include <linux/unix_diag.h>
+#include <netinet/in.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+// Large enough for the kernel to fill each recv() with a few hundred sockets
+static const size_t RECEIVE_BUFFER = 64 * 1024;
+
+static int address_compare(const socket_t& a, const socket_t& b,
+                           bool remote) {
+  if (a.family != b.family)
+    return a.family - b.family;
+  if (a.family == AF_UNIX)
+    return remote ? (int)(a.peer > b.peer) - (int)(a.peer < b.peer)
+                  : a.path.compare(b.path);
+
+  // Network order, so the bytes sort like the addresses
+  const int addr = remote ? memcmp(a.remote_addr.data(), b.remote_addr.data(),
+                                   a.remote_addr.size())
+                          : memcmp(a.local_addr.data(), b.local_addr.data(),
+                                   a.local_addr.size());
+  if (addr != 0)
+    return addr;
+  return remote ? a.remote_port - b.remote_port : a.local_port - b.local_port;
+}
+
+bool socket_less(const socket_t& a, const socket_t& b, int column) {
+  switch (column) {
+  case SOCKET_COLUMN_PROTOCOL:
+    if (a.protocol != b.protocol)
+      return a.protocol < b.protocol;
+    return a.family < b.family;
+  case SOCKET_COLUMN_STATE:
+    return a.state < b.state;
+  case SOCKET_COLUMN_LOCAL:
+    return address_compare(a, b, false) < 0;
+  case SOCKET_COLUMN_REMOTE:
+    return address_compare(a, b, true) < 0;
+  case SOCKET_COLUMN_RX_QUEUE:
+    return a.rx_queue < b.rx_queue;
+  case SOCKET_COLUMN_TX_QUEUE:
+    return a.tx_queue < b.tx_queue;
+  case SOCKET_COLUMN_RTT:
+    return a.rtt < b.rtt;
+  case SOCKET_COLUMN_RETRANSMITS:
+    return a.retransmits < b.retransmits;
+  case SOCKET_COLUMN_ACKED:
+    return a.bytes_acked < b.bytes_acked;
+  case SOCKET_COLUMN_RECEIVED:
+    return a.bytes_received < b.bytes_received;
+  default:
+    return a.uid < b.uid;
+  }
+}
+
+const char* socket_state_name(uint8_t state) {
+  static const char* names[] = {
+      "UNKNOWN",
+      "ESTABLISHED",
+      "SYN_SENT",
+      "SYN_RECV",
+      "FIN_WAIT1",
+      "FIN_WAIT2",
+      "TIME_WAIT",
+      "CLOSE",
+      "CLOSE_WAIT",
+      "LAST_ACK",
+      "LISTEN",
+      "CLOSING",
+      "NEW_SYN_RECV",
+  };
+
+  if (state >= sizeof(names) / sizeof(names[0]))
+    return names[0];
+  return names[state];
+}
+
+std::string socket_address(const socket_t& socket, bool remote) {
+  if (socket.family == AF_UNIX) {
+    if (!remote)
+      return socket.path.empty() ? "*" : socket.path;
+    return socket.peer ? "peer " + std::to_string(socket.peer) : "*";
+  }
+
+  const std::array<uint8_t, 16>& addr =
+      remote ? socket.remote_addr : socket.local_addr;
+  const uint16_t port = remote ? socket.remote_port : socket.local_port;
+
+  char text[INET6_ADDRSTRLEN];
+  inet_ntop(socket.family, addr.data(), text, sizeof(text));
+  std::string address = socket.family == AF_INET6
+                            ? std::string("[") + text + "]"
+                            : std::string(text);
+  return address + ":" + (port ? std::to_string(port) : "*");
+}
+
+SocketDiag::SocketDiag() : m_error(0), m_sequence(0) {
+  m_fd = socket(AF_NETLINK, SOCK_DGRAM | SOCK_CLOEXEC, NETLINK_SOCK_DIAG);
+  if (m_fd < 0) {
+    m_error = errno;
+    return;
+  }
+
+  // Fewer round trips on the hosts having hundreds of thousands of sockets,
+  // silently capped by net.core.rmem_max
+  const int size = 4 * 1024 * 1024;
+  setsockopt(m_fd, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+  m_buffer.resize(RECEIVE_BUFFER);
+}
+
+SocketDiag::~SocketDiag() {
+  if (m_fd >= 0)
+    close(m_fd);
+}
+
+int SocketDiag::error() const { return m_error; }
+
+bool SocketDiag::dump(const socket_filter_t& filter,
+                      std::vector<socket_t>& sockets) {
+  const size_t previous = sockets.size();
+  sockets.clear();
+  sockets.reserve(previous);
+  if (m_fd < 0)
+    return false;
+
+  // A missing protocol module (udp_diag...) does not hide the others
+  bool success = true;
+  m_error = 0;
+  if (filter.tcp) {
+    success &= dump_inet(AF_INET, IPPROTO_TCP, filter, sockets);
+    success &= dump_inet(AF_INET6, IPPROTO_TCP, filter, sockets);
+  }
+  if (filter.udp) {
+    success &= dump_inet(AF_INET, IPPROTO_UDP, filter, sockets);
+    success &= dump_inet(AF_INET6, IPPROTO_UDP, filter, sockets);
+  }
+  if (filter.unix_ && filter.port == 0)
+    success &= dump_unix(filter, sockets);
+  return success;
+}
+
+// "sport == port || dport == port" with the range comparisons understood by
+// every kernel. A jump to the end accepts, past the end rejects. The kernel
+// only allows jumps to the operations reached by following the "yes" ones.
+static const int PORT_BYTECODE = 9;
+
+static size_t port_bytecode(uint16_t port, inet_diag_bc_op* ops) {
+  const inet_diag_bc_op program[PORT_BYTECODE] = {
+      {INET_DIAG_BC_S_GE, 8, 20},
+      {0, 0, port},
+      {INET_DIAG_BC_S_LE, 8, 12},
+      {0, 0, port},
+      {INET_DIAG_BC_JMP, 4, 20}, // the source port matched
+      {INET_DIAG_BC_D_GE, 8, 20},
+      {0, 0, port},
+      {INET_DIAG_BC_D_LE, 8, 12},
+      {0, 0, port},
+  };
+
+  memcpy(ops, program, sizeof(program));
+  return sizeof(program);
+}
+
+bool SocketDiag::dump_inet(uint8_t family, uint8_t protocol,
+                           const socket_filter_t& filter,
+                           std::vector<socket_t>& sockets) {
+  struct {
+    nlmsghdr header;
+    inet_diag_req_v2 request;
+    rtattr bytecode;
+    inet_diag_bc_op ops[PORT_BYTECODE];
+  } message = {};
+
+  message.request.sdiag_family = family;
+  message.request.sdiag_protocol = protocol;
+  message.request.idiag_states = filter.states;
+  if (protocol == IPPROTO_TCP)
+    message.request.idiag_ext = 1 << (INET_DIAG_INFO - 1);
+
+  size_t length = NLMSG_LENGTH(sizeof(message.request));
+  if (filter.port) {
+    const size_t program = port_bytecode(filter.port, message.ops);
+    message.bytecode.rta_type = INET_DIAG_REQ_BYTECODE;
+    message.bytecode.rta_len = RTA_LENGTH(program);
+    length += RTA_SPACE(program);
+  }
+  message.header.nlmsg_len = length;
+
+  if (!request(&message, length))
+    return false;
+  return receive(sockets,
+                 protocol == IPPROTO_TCP ? SOCKET_TCP : SOCKET_UDP);
+}
+
+bool SocketDiag::dump_unix(const socket_filter_t& filter,
+                           std::vector<socket_t>& sockets) {
+  struct {
+    nlmsghdr header;
+    unix_diag_req request;
+  } message = {};
+
+  message.header.nlmsg_len = sizeof(message);
+  message.request.sdiag_family = AF_UNIX;
+  message.request.udiag_states = filter.states;
+  message.request.udiag_show = UDIAG_SHOW_NAME | UDIAG_SHOW_PEER |
+                               UDIAG_SHOW_RQLEN | UDIAG_SHOW_UID;
+
+  if (!request(&message, sizeof(message)))
+    return false;
+  return receive(sockets, SOCKET_UNIX);
+}
+
+bool SocketDiag::request(const void* message, size_t length) {
+  nlmsghdr* header = (nlmsghdr*)message;
+  header->nlmsg_type = SOCK_DIAG_BY_FAMILY;
+  header->nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP;
+  header->nlmsg_seq = ++m_sequence;
+
+  sockaddr_nl kernel = {};
+  kernel.nl_family = AF_NETLINK;
+  if (sendto(m_fd, message, length, 0, (sockaddr*)&kernel, sizeof(kernel)) <
+      0) {
+    m_error = errno;
+    return false;
+  }
+  return true;
+}
+
+static void parse_inet(const nlmsghdr* header, socket_t& socket) {
+  const inet_diag_msg* msg = (const inet_diag_msg*)NLMSG_DATA(header);
+  socket.family = msg->idiag_family;
+  socket.state = msg->idiag_state;
+  const size_t size = msg->idiag_family == AF_INET ? 4 : 16;
+  memcpy(socket.local_addr.data(), msg->id.idiag_src, size);
+  memcpy(socket.remote_addr.data(), msg->id.idiag_dst, size);
+  socket.local_port = ntohs(msg->id.idiag_sport);
+  socket.remote_port = ntohs(msg->id.idiag_dport);
+  socket.rx_queue = msg->idiag_rqueue;
+  socket.tx_queue = msg->idiag_wqueue;
+  socket.inode = msg->idiag_inode;
+  socket.uid = msg->idiag_uid;
+
+  int length = header->nlmsg_len - NLMSG_LENGTH(sizeof(*msg));
+  for (const rtattr* attr = (const rtattr*)(msg + 1); RTA_OK(attr, length);
+       attr = RTA_NEXT(attr, length)) {
+    if (attr->rta_type != INET_DIAG_INFO)
+      continue;
+
+    // Older kernels send a shorter structure
+    tcp_info info = {};
+    memcpy(&info, RTA_DATA(attr),
+           std::min<size_t>(RTA_PAYLOAD(attr), sizeof(info)));
+    socket.info = true;
+    socket.rtt = info.tcpi_rtt;
+    socket.rttvar = info.tcpi_rttvar;
+    socket.retransmits = info.tcpi_total_retrans;
+    socket.bytes_acked = info.tcpi_bytes_acked;
+    socket.bytes_received = info.tcpi_bytes_received;
+  }
+}
+
+static void parse_unix(const nlmsghdr* header, socket_t& socket) {
+  const unix_diag_msg* msg = (const unix_diag_msg*)NLMSG_DATA(header);
+  socket.family = AF_UNIX;
+  socket.state = msg->udiag_state;
+  socket.type = msg->udiag_type;
+  socket.inode = msg->udiag_ino;
+
+  int length = header->nlmsg_len - NLMSG_LENGTH(sizeof(*msg));
+  for (const rtattr* attr = (const rtattr*)(msg + 1); RTA_OK(attr, length);
+       attr = RTA_NEXT(attr, length)) {
+    const char* data = (const char*)RTA_DATA(attr);
+    switch (attr->rta_type) {
+    case UNIX_DIAG_NAME:
+      // Abstract names start with a NUL, shown as '@' like ss does
+      socket.path.assign(data, strnlen(data + 1, RTA_PAYLOAD(attr) - 1) + 1);
+      if (socket.path[0] == '\0')
+        socket.path[0] = '@';
+      break;
+    case UNIX_DIAG_PEER:
+      memcpy(&socket.peer, data, sizeof(socket.peer));
+      break;
+    case UNIX_DIAG_RQLEN: {
+      unix_diag_rqlen rqlen;
+      memcpy(&rqlen, data, sizeof(rqlen));
+      socket.rx_queue = rqlen.udiag_rqueue;
+      socket.tx_queue = rqlen.udiag_wqueue;
+      break;
+    }
+    case UNIX_DIAG_UID:
+      memcpy(&socket.uid, data, sizeof(socket.uid));
+      break;
+    }
+  }
+}
+
+bool SocketDiag::receive(std::vector<socket_t>& sockets,
+                         socket_protocol_t protocol) {
+  for (;;) {
+    const ssize_t received =
+        recv(m_fd, m_buffer.data(), m_buffer.size(), 0);
+    if (received < 0) {
+      if (errno == EINTR)
+        continue;
+      m_error = errno;
+      return false;
+    }
+
+    int length = received;
+    for (const nlmsghdr* header = (const nlmsghdr*)m_buffer.data();
+         NLMSG_OK(header, length); header = NLMSG_NEXT(header, length)) {
+      if (header->nlmsg_seq != m_sequence)
+        continue; // Left over by an aborted dump
+      if (header->nlmsg_type == NLMSG_DONE)
+        return true;
+      if (header->nlmsg_type == NLMSG_ERROR) {
+        const nlmsgerr* error = (const nlmsgerr*)NLMSG_DATA(header);
+        m_error = -error->error;
+        return false;
+      }
+      if (header->nlmsg_type != SOCK_DIAG_BY_FAMILY)
+        continue;
+
+      sockets.emplace_back();
+      socket_t& socket = sockets.back();
+      socket.protocol = protocol;
+      if (protocol == SOCKET_UNIX)
+        parse_unix(header, socket);
+      else
+        parse_inet(header, socket);
+    }
+  }
+}
@@ -0,0 +1,99 @@
+#ifndef __SOCKETS_HPP__
+#define __SOCKETS_HPP__
+
+#include <array>
+#include <stdint.h>
+#include <string>
+#include <sys/types.h>
+#include <vector>
+
+enum socket_protocol_t {
+  SOCKET_TCP,
+  SOCKET_UDP,
+  SOCKET_UNIX,
+};
+
+// Addresses are kept in binary and only formatted for the rows displayed
+struct socket_t {
+  socket_protocol_t protocol;
+  uint8_t family; // AF_INET, AF_INET6 or AF_UNIX
+  uint8_t state;  // TCP_ESTABLISHED..., also used by UDP and Unix sockets
+  uint8_t type;   // SOCK_STREAM, SOCK_DGRAM or SOCK_SEQPACKET for Unix ones
+  std::array<uint8_t, 16> local_addr;
+  std::array<uint8_t, 16> remote_addr;
+  uint16_t local_port;
+  uint16_t remote_port;
+  std::string path;  // bound Unix socket, empty otherwise
+  uint32_t peer;     // inode of the peer of a Unix socket
+  uint32_t rx_queue; // accept backlog of the listening sockets
+  uint32_t tx_queue; // maximum backlog of the listening sockets
+  uint32_t inode;
+  uid_t uid;
+
+  // tcp_info, TCP only
+  bool info;
+  uint32_t rtt;    // microseconds, smoothed
+  uint32_t rttvar; // microseconds
+  uint32_t retransmits;
+  uint64_t bytes_acked;
+  uint64_t bytes_received;
+};
+
+// Applied by the kernel while dumping
+struct socket_filter_t {
+  uint32_t states; // 1 << state, TCP_* states
+  uint16_t port;   // local or remote, 0 for any. Unix sockets are skipped.
+  bool tcp;
+  bool udp;
+  bool unix_;
+};
+
+// Columns of the connections table, in order
+enum socket_column_t {
+  SOCKET_COLUMN_PROTOCOL,
+  SOCKET_COLUMN_STATE,
+  SOCKET_COLUMN_LOCAL,
+  SOCKET_COLUMN_REMOTE,
+  SOCKET_COLUMN_RX_QUEUE,
+  SOCKET_COLUMN_TX_QUEUE,
+  SOCKET_COLUMN_RTT,
+  SOCKET_COLUMN_RETRANSMITS,
+  SOCKET_COLUMN_ACKED,
+  SOCKET_COLUMN_RECEIVED,
+  SOCKET_COLUMN_UID,
+  SOCKET_COLUMNS,
+};
+
+bool socket_less(const socket_t& a, const socket_t& b, int column);
+
+const char* socket_state_name(uint8_t state);
+std::string socket_address(const socket_t& socket, bool remote);
+
+// inet_diag and unix_diag dumps over a NETLINK_SOCK_DIAG socket kept open.
+// A dump is a single request per family and protocol, the replies being
+// parsed straight from the receive buffer.
+class SocketDiag {
+public:
+  SocketDiag();
+  ~SocketDiag();
+
+  int error() const;
+
+  // Replaces sockets, false when a dump failed
+  bool dump(const socket_filter_t& filter, std::vector<socket_t>& sockets);
+
+private:
+  bool dump_inet(uint8_t family, uint8_t protocol,
+                 const socket_filter_t& filter, std::vector<socket_t>& sockets);
+  bool dump_unix(const socket_filter_t& filter,
+                 std::vector<socket_t>& sockets);
+  bool request(const void* message, size_t length);
+  bool receive(std::vector<socket_t>& sockets, socket_protocol_t protocol);
+
+  int m_fd;
+  int m_error;
+  uint32_t m_sequence;
+  std::vector<char> m_buffer;
+};
+
+#endif
@@ -0,0 +1,99 @@
+#include "worker_pool.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+
+WorkerPool::WorkerPool(int workers) : m_sequence(0), m_stop(false) {
+  for (int i = 0; i < workers; i++)
+    m_threads.emplace_back(&WorkerPool::work, this);
+}
+
+WorkerPool::~WorkerPool() { stop(); }
+
+void WorkerPool::submit(clock::time_point deadline,
+                        std::function<void()> job) {
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_stop)
+      return;
+    m_jobs.push(job_t{deadline, m_sequence++, std::move(job)});
+  }
+  m_cv.notify_one();
+}
+
+void WorkerPool::parallel_for(size_t count,
+                              std::function<void(size_t)> run) {
+  struct state_t {
+    std::function<void(size_t)> run;
+    size_t count;
+    std::atomic<size_t> next;
+    std::mutex mutex;
+    std::condition_variable cv;
+    size_t done;
+  };
+
+  // Shared with the helpers, which may only get a worker once all is done
+  std::shared_ptr<state_t> state = std::make_shared<state_t>();
+  state->run = std::move(run);
+  state->count = count;
+  state->next = 0;
+  state->done = 0;
+
+  const auto drain = [](state_t& state) {
+    size_t finished = 0;
+    for (;;) {
+      const size_t index = state.next.fetch_add(1);
+      if (index >= state.count)
+        break;
+      state.run(index);
+      finished++;
+    }
+    if (finished == 0)
+      return;
+
+    std::lock_guard<std::mutex> lock(state.mutex);
+    state.done += finished;
+    if (state.done == state.count)
+      state.cv.notify_all();
+  };
+
+  const size_t helpers = std::min<size_t>(size(), count > 0 ? count - 1 : 0);
+  for (size_t i = 0; i < helpers; i++)
+    submit(clock::now(), [state, drain]() { drain(*state); });
+
+  drain(*state);
+
+  std::unique_lock<std::mutex> lock(state->mutex);
+  state->cv.wait(lock, [&state]() { return state->done == state->count; });
+}
+
+void WorkerPool::stop() {
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_stop)
+      return;
+    m_stop = true;
+  }
+  m_cv.notify_all();
+
+  for (std::thread& thread : m_threads)
+    thread.join();
+  m_threads.clear();
+}
+
+void WorkerPool::work() {
+  for (;;) {
+    std::function<void()> job;
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_cv.wait(lock, [this]() { return m_stop || !m_jobs.empty(); });
+      if (m_stop)
+        return;
+
+      job = std::move(const_cast<job_t&>(m_jobs.top()).run);
+      m_jobs.pop();
+    }
+    job();
+  }
+}
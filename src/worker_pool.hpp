@@ -0,0 +1,56 @@
+#ifndef __WORKER_POOL_HPP__
+#define __WORKER_POOL_HPP__
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+// Small pool of threads running jobs by order of deadline: the job whose
+// deadline is the earliest is always the next one to be picked.
+class WorkerPool {
+public:
+  typedef std::chrono::steady_clock clock;
+
+  WorkerPool(int workers);
+  ~WorkerPool();
+
+  void submit(clock::time_point deadline, std::function<void()> job);
+  // Runs run(0) ... run(count - 1) on the workers and on the calling thread,
+  // returns once all of them are done. The indices are claimed one at a time
+  // from a shared counter, so a worker done with a cheap shard takes the next
+  // one instead of idling while another is stuck on a slow one. The caller
+  // takes part, which keeps it safe to call from one of the workers.
+  void parallel_for(size_t count, std::function<void(size_t)> run);
+  void stop();
+
+  int size() const { return m_threads.size(); }
+
+private:
+  struct job_t {
+    clock::time_point deadline;
+    uint64_t sequence;
+    std::function<void()> run;
+
+    bool operator<(const job_t& other) const {
+      // std::priority_queue is a max-heap
+      if (deadline != other.deadline)
+        return deadline > other.deadline;
+      return sequence > other.sequence;
+    }
+  };
+
+  void work();
+
+  std::mutex m_mutex;
+  std::condition_variable m_cv;
+  std::priority_queue<job_t> m_jobs;
+  std::vector<std::thread> m_threads;
+  uint64_t m_sequence;
+  bool m_stop;
+};
+
+#endif